@@ -0,0 +1,301 @@
+// AccessLog.cpp
+#include "AccessLog.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <time.h>
+
+namespace
+{
+    // 二进制日志的文件头
+    const char kBinaryMagic[8] = {'C', 'C', 'A', 'C', 'L', 'O', 'G', '1'};
+
+    // 后台线程的最长等待间隔
+    const int kDrainIntervalMs = 20;
+
+    // 批量写出的阈值
+    const size_t kBatchBytes = 64 * 1024;
+
+    uint16_t copyText(char *dst, size_t room, std::string_view text)
+    {
+        size_t n = std::min(room, text.size());
+        if (n > 0)
+        {
+            memcpy(dst, text.data(), n);
+        }
+        return static_cast<uint16_t>(n);
+    }
+
+    // 引号、反斜杠和不可见字符写成 \xHH，避免日志行被请求内容破坏
+    void appendEscaped(std::string *out, const char *data, size_t len)
+    {
+        static const char *digits = "0123456789abcdef";
+        if (len == 0)
+        {
+            out->push_back('-');
+            return;
+        }
+        for (size_t i = 0; i < len; ++i)
+        {
+            unsigned char c = static_cast<unsigned char>(data[i]);
+            if (c == '"' || c == '\\' || c < 0x20 || c >= 0x7f)
+            {
+                char hex[4] = {'\\', 'x', digits[c >> 4], digits[c & 0xf]};
+                out->append(hex, 4);
+            }
+            else
+            {
+                out->push_back(static_cast<char>(c));
+            }
+        }
+    }
+}
+
+AccessLog::Ring::Ring(size_t capacity)
+{
+    size_t size = 1;
+    while (size < capacity)
+    {
+        size <<= 1;
+    }
+    records_.resize(size);
+    mask_ = size - 1;
+}
+
+AccessLog::AccessLog(const std::string &path, Format format, int sampleRate, size_t ringCapacity)
+    : fp_(fopen(path.c_str(), "ae")),
+      format_(format),
+      sampleRate_(sampleRate > 1 ? static_cast<uint64_t>(sampleRate) : 1),
+      ringCapacity_(ringCapacity)
+{
+    if (fp_ != nullptr && format_ == kBinary)
+    {
+        fseek(fp_, 0, SEEK_END);
+        if (ftell(fp_) == 0)
+        {
+            fwrite(kBinaryMagic, 1, sizeof kBinaryMagic, fp_);
+        }
+    }
+    batch_.reserve(kBatchBytes * 2);
+    writer_ = std::thread(&AccessLog::writerLoop, this);
+}
+
+AccessLog::~AccessLog()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+    }
+    cond_.notify_one();
+    writer_.join();
+    if (fp_ != nullptr)
+    {
+        fclose(fp_);
+    }
+}
+
+AccessLog::Ring *AccessLog::createRing()
+{
+    auto ring = std::make_unique<Ring>(ringCapacity_);
+    Ring *result = ring.get();
+    std::lock_guard<std::mutex> lock(ringsMutex_);
+    rings_.push_back(std::move(ring));
+    return result;
+}
+
+void AccessLog::log(Ring *ring, const RequestContext &context, std::string_view peer,
+                    const HttpRequest *request, int status, uint64_t bytes)
+{
+    // 错误响应总是记录，其余按采样率记录
+    if (sampleRate_ > 1 && status < 400 && ++ring->sequence_ % sampleRate_ != 0)
+    {
+        return;
+    }
+
+    AccessRecord *record = ring->reserve();
+    if (record == nullptr)
+    {
+        ring->dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    record->timeUs = context.receiveTime.microSecondsSinceEpoch();
+    record->requestId = context.id;
+    record->latencyNs = context.totalNs();
+    record->bytes = bytes;
+    record->status = static_cast<uint16_t>(status);
+    record->peerLen = copyText(record->peer, AccessRecord::kPeerSize, peer);
+
+    if (request != nullptr)
+    {
+        record->method = static_cast<uint8_t>(request->method());
+        record->http10 = request->version() == "HTTP/1.0";
+
+        char *text = record->text;
+        size_t room = AccessRecord::kTextSize;
+        uint16_t targetLen = copyText(text, room, request->path());
+        if (!request->query().empty() && targetLen < room)
+        {
+            text[targetLen++] = '?';
+            targetLen += copyText(text + targetLen, room - targetLen, request->query());
+        }
+        record->targetLen = targetLen;
+        record->refererLen = copyText(text + targetLen, room - targetLen, request->getHeader(HttpHeader::kReferer));
+        size_t used = targetLen + record->refererLen;
+        record->agentLen = copyText(text + used, room - used, request->getHeader(HttpHeader::kUserAgent));
+    }
+    else
+    {
+        record->method = HttpRequest::kInvalid;
+        record->http10 = 0;
+        record->targetLen = 0;
+        record->refererLen = 0;
+        record->agentLen = 0;
+    }
+
+    ring->commit();
+}
+
+uint64_t AccessLog::droppedCount() const
+{
+    uint64_t dropped = 0;
+    std::lock_guard<std::mutex> lock(ringsMutex_);
+    for (const auto &ring : rings_)
+    {
+        dropped += ring->dropped_.load(std::memory_order_relaxed);
+    }
+    return dropped;
+}
+
+void AccessLog::writerLoop()
+{
+    for (;;)
+    {
+        bool stop;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cond_.wait_for(lock, std::chrono::milliseconds(kDrainIntervalMs),
+                           [this]()
+                           { return !running_; });
+            stop = !running_;
+        }
+
+        drain();
+
+        if (stop)
+        {
+            break;
+        }
+    }
+}
+
+size_t AccessLog::drain()
+{
+    std::vector<Ring *> rings;
+    {
+        std::lock_guard<std::mutex> lock(ringsMutex_);
+        for (const auto &ring : rings_)
+        {
+            rings.push_back(ring.get());
+        }
+    }
+
+    size_t count = 0;
+    for (Ring *ring : rings)
+    {
+        size_t head = ring->head_.load(std::memory_order_relaxed);
+        size_t tail = ring->tail_.load(std::memory_order_acquire);
+        for (; head != tail; ++head)
+        {
+            const AccessRecord &record = ring->records_[head & ring->mask_];
+            if (format_ == kBinary)
+            {
+                appendBinary(record);
+            }
+            else
+            {
+                appendCombined(record);
+            }
+            ++count;
+
+            if (batch_.size() >= kBatchBytes)
+            {
+                if (fp_ != nullptr)
+                {
+                    fwrite(batch_.data(), 1, batch_.size(), fp_);
+                }
+                batch_.clear();
+            }
+        }
+        // 槽位格式化完后才交还给生产者
+        ring->head_.store(head, std::memory_order_release);
+    }
+
+    if (count > 0)
+    {
+        if (fp_ != nullptr)
+        {
+            fwrite(batch_.data(), 1, batch_.size(), fp_);
+            fflush(fp_);
+        }
+        batch_.clear();
+        written_.fetch_add(count, std::memory_order_relaxed);
+    }
+    return count;
+}
+
+void AccessLog::appendCombined(const AccessRecord &record)
+{
+    // peer - - [10/Oct/2026:13:55:36 +0000] "GET /path HTTP/1.1" 200 2326 "referer" "agent" 532 000100000000002a
+    int64_t second = record.timeUs / 1000000;
+    if (second != lastSecond_)
+    {
+        lastSecond_ = second;
+        time_t t = static_cast<time_t>(second);
+        struct tm tm;
+        gmtime_r(&t, &tm);
+        strftime(timeBuf_, sizeof timeBuf_, "%d/%b/%Y:%H:%M:%S +0000", &tm);
+    }
+
+    const char *text = record.text;
+    batch_.append(record.peer, record.peerLen);
+    batch_.append(" - - [", 6);
+    batch_.append(timeBuf_);
+    batch_.append("] \"", 3);
+    if (record.method == HttpRequest::kInvalid)
+    {
+        batch_.push_back('-');
+    }
+    else
+    {
+        batch_.append(HttpRequest::methodToString(static_cast<HttpRequest::Method>(record.method)));
+        batch_.push_back(' ');
+        appendEscaped(&batch_, text, record.targetLen);
+        batch_.append(record.http10 ? " HTTP/1.0" : " HTTP/1.1");
+    }
+
+    char numbers[96];
+    int n = snprintf(numbers, sizeof numbers, "\" %u %llu \"", static_cast<unsigned>(record.status),
+                     static_cast<unsigned long long>(record.bytes));
+    batch_.append(numbers, n);
+    appendEscaped(&batch_, text + record.targetLen, record.refererLen);
+    batch_.append("\" \"", 3);
+    appendEscaped(&batch_, text + record.targetLen + record.refererLen, record.agentLen);
+
+    char id[RequestContext::kIdLength];
+    RequestContext::formatId(record.requestId, id);
+    n = snprintf(numbers, sizeof numbers, "\" %lld ", static_cast<long long>(record.latencyNs / 1000));
+    batch_.append(numbers, n);
+    batch_.append(id, sizeof id);
+    batch_.push_back('\n');
+}
+
+void AccessLog::appendBinary(const AccessRecord &record)
+{
+    // 定长部分（到 agentLen 为止）之后紧跟 peer 和 text 的有效字节
+    batch_.append(reinterpret_cast<const char *>(&record), offsetof(AccessRecord, peer));
+    batch_.append(record.peer, record.peerLen);
+    batch_.append(record.text, record.targetLen + record.refererLen + record.agentLen);
+}
@@ -0,0 +1,121 @@
+// AccessLog.h
+#pragma once
+
+#include "HttpRequest.h"
+#include "RequestContext.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// 一条访问日志，IO 线程直接在环形缓冲区的槽位里填写，不做任何格式化
+struct AccessRecord
+{
+    static constexpr size_t kPeerSize = 48;
+    static constexpr size_t kTextSize = 256;
+
+    int64_t timeUs;     // 收到请求的时间（微秒，Unix 时间）
+    uint64_t requestId;
+    int64_t latencyNs;  // 从收到请求到响应序列化完成
+    uint64_t bytes;     // 响应字节数，含文件响应体
+    uint16_t status;
+    uint8_t method;     // HttpRequest::Method
+    uint8_t http10;     // 是否为 HTTP/1.0
+    uint16_t peerLen;
+    uint16_t targetLen; // 路径加查询串
+    uint16_t refererLen;
+    uint16_t agentLen;
+    char peer[kPeerSize];
+    char text[kTextSize]; // target、Referer、User-Agent 依次存放，超长截断
+};
+
+// 访问日志：每个 IO 线程一个单生产者单消费者的环形缓冲区，后台线程批量取出并写入文件。
+// 环满时丢弃新记录并计数，不会阻塞 IO 线程
+class AccessLog
+{
+public:
+    enum Format
+    {
+        kCombined, // 文本格式：Combined Log Format 末尾追加耗时（微秒）和请求 ID
+        kBinary    // 二进制格式：文件头之后是变长记录，整数为本机字节序
+    };
+
+    // 每个 IO 线程独有，生产者只有该线程，消费者只有后台线程
+    class Ring
+    {
+    public:
+        explicit Ring(size_t capacity);
+
+        // 返回可写入的槽位，环满时返回 nullptr
+        AccessRecord *reserve()
+        {
+            size_t tail = tail_.load(std::memory_order_relaxed);
+            if (tail - head_.load(std::memory_order_acquire) == records_.size())
+            {
+                return nullptr;
+            }
+            return &records_[tail & mask_];
+        }
+
+        void commit() { tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+    private:
+        friend class AccessLog;
+
+        std::vector<AccessRecord> records_;
+        size_t mask_;
+        uint64_t sequence_ = 0; // 采样计数，只由生产者访问
+        alignas(64) std::atomic<size_t> head_{0};
+        alignas(64) std::atomic<size_t> tail_{0};
+        std::atomic<uint64_t> dropped_{0};
+    };
+
+    // sampleRate 为 N 时每 N 个请求记录一个，状态码 >= 400 的请求总是记录。
+    // ringCapacity 向上取整为 2 的幂
+    AccessLog(const std::string &path, Format format, int sampleRate = 1, size_t ringCapacity = 2048);
+    ~AccessLog();
+
+    // 为调用线程创建环形缓冲区，由 IO 线程初始化时调用一次
+    Ring *createRing();
+
+    // IO 线程在请求处理完成后调用，request 为 nullptr 表示请求无法解析
+    void log(Ring *ring, const RequestContext &context, std::string_view peer,
+             const HttpRequest *request, int status, uint64_t bytes);
+
+    uint64_t writtenCount() const { return written_.load(std::memory_order_relaxed); }
+    uint64_t droppedCount() const;
+
+private:
+    void writerLoop();
+    // 取出所有环中的记录写入文件，返回写出的条数
+    size_t drain();
+    void appendCombined(const AccessRecord &record);
+    void appendBinary(const AccessRecord &record);
+
+    FILE *fp_;
+    Format format_;
+    uint64_t sampleRate_;
+    size_t ringCapacity_;
+
+    mutable std::mutex ringsMutex_;
+    std::vector<std::unique_ptr<Ring>> rings_;
+
+    std::atomic<uint64_t> written_{0};
+
+    // 只由后台线程访问
+    std::string batch_;
+    int64_t lastSecond_ = -1;
+    char timeBuf_[32];
+
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    bool running_ = true;
+    std::thread writer_;
+};
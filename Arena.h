@@ -0,0 +1,130 @@
+// Arena.h
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory_resource>
+#include <new>
+#include <string_view>
+
+// 只增不减的线性分配器：分配只移动指针，deallocate 不做任何事，reset 一次性回收全部内存。
+// reset 之后保留已达到的容量：上一轮用到了多个块时合并成一个足够大的块，
+// 稳定之后每一轮都在同一个块内分配，不再调用 malloc/free。
+// 作为 std::pmr::memory_resource 使用时，容器也必须在 reset 之前销毁。不是线程安全的
+class Arena : public std::pmr::memory_resource
+{
+public:
+    static constexpr size_t kDefaultBlockSize = 4096;
+
+    explicit Arena(size_t initialSize = kDefaultBlockSize)
+        : head_(nullptr), ptr_(nullptr), end_(nullptr), capacity_(0), nextSize_(initialSize)
+    {
+    }
+
+    ~Arena() override { freeBlocks(); }
+
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    // 把字符串拷贝到 arena 中，返回指向副本的视图
+    std::string_view copy(std::string_view text)
+    {
+        if (text.empty())
+        {
+            return std::string_view();
+        }
+        char *data = static_cast<char *>(allocate(text.size(), 1));
+        std::memcpy(data, text.data(), text.size());
+        return std::string_view(data, text.size());
+    }
+
+    // 回收本轮分配的全部内存，只有一个块时为 O(1)
+    void reset()
+    {
+        if (head_ == nullptr)
+        {
+            return;
+        }
+        if (head_->next != nullptr)
+        {
+            size_t total = capacity_;
+            freeBlocks();
+            addBlock(total);
+        }
+        ptr_ = head_->data();
+    }
+
+    // 已分配的块的总容量
+    size_t capacity() const { return capacity_; }
+
+    // 当前块中已使用的字节数
+    size_t used() const { return head_ != nullptr ? static_cast<size_t>(ptr_ - head_->data()) : 0; }
+
+protected:
+    void *do_allocate(size_t bytes, size_t alignment) override
+    {
+        char *aligned = align(ptr_, alignment);
+        if (aligned == nullptr || aligned + bytes > end_)
+        {
+            addBlock(std::max(bytes + alignment, nextSize_));
+            aligned = align(ptr_, alignment);
+        }
+        ptr_ = aligned + bytes;
+        return aligned;
+    }
+
+    void do_deallocate(void *, size_t, size_t) override {}
+
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override { return this == &other; }
+
+private:
+    struct alignas(std::max_align_t) Block
+    {
+        Block *next;
+        size_t size;
+
+        char *data() { return reinterpret_cast<char *>(this + 1); }
+    };
+
+    static char *align(char *ptr, size_t alignment)
+    {
+        if (ptr == nullptr)
+        {
+            return nullptr;
+        }
+        uintptr_t value = reinterpret_cast<uintptr_t>(ptr);
+        return ptr + ((alignment - value % alignment) % alignment);
+    }
+
+    void addBlock(size_t size)
+    {
+        Block *block = static_cast<Block *>(::operator new(sizeof(Block) + size));
+        block->next = head_;
+        block->size = size;
+        head_ = block;
+        ptr_ = block->data();
+        end_ = ptr_ + size;
+        capacity_ += size;
+        nextSize_ = std::max(nextSize_, size * 2);
+    }
+
+    void freeBlocks()
+    {
+        while (head_ != nullptr)
+        {
+            Block *next = head_->next;
+            ::operator delete(head_);
+            head_ = next;
+        }
+        ptr_ = end_ = nullptr;
+        capacity_ = 0;
+    }
+
+    Block *head_; // 最新的块，只在这个块里分配
+    char *ptr_;
+    char *end_;
+    size_t capacity_;
+    size_t nextSize_;
+};
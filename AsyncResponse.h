@@ -0,0 +1,91 @@
+// AsyncResponse.h
+#pragma once
+
+#include "HttpRequest.h"
+#include "HttpResponse.h"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+
+// 拷贝出连接 Buffer 的请求：原始字节保存在 bytes 中，request 的视图指向这份副本，
+// 可以在任意线程、任意时刻访问
+struct DetachedRequest
+{
+    DetachedRequest(const HttpRequest &original, const char *data, size_t len)
+        : bytes(data, len),
+          decodedBody(inside(original.body(), data, len) ? std::string() : std::string(original.body())),
+          request(original)
+    {
+        request.rebase(data, len, bytes.data());
+        if (!decodedBody.empty())
+        {
+            request.setBody(decodedBody);
+        }
+    }
+
+    DetachedRequest(const DetachedRequest &) = delete;
+    DetachedRequest &operator=(const DetachedRequest &) = delete;
+
+    const std::string bytes;
+    // 解码后的 chunked 请求体不在原始字节中，单独拷贝
+    const std::string decodedBody;
+    HttpRequest request;
+
+private:
+    static bool inside(std::string_view view, const char *data, size_t len)
+    {
+        return view.empty() || (view.data() >= data && view.data() + view.size() <= data + len);
+    }
+};
+
+using DetachedRequestPtr = std::shared_ptr<const DetachedRequest>;
+
+// 异步处理函数的完成对象。处理函数可以在任意线程、任意时刻调用一次 complete，
+// 响应在调用线程上序列化，再投递回连接所属的 IO 线程发送。
+// 没有调用 complete 就被销毁时（例如处理函数抛出异常）自动回复 500
+class ResponseCompletion
+{
+public:
+    using Finisher = std::function<void(const DetachedRequestPtr &, HttpResponse *)>;
+
+    ResponseCompletion(DetachedRequestPtr request, Finisher finisher)
+        : request_(std::move(request)), finisher_(std::move(finisher)), completed_(false)
+    {
+    }
+
+    ~ResponseCompletion()
+    {
+        if (!completed_.load(std::memory_order_relaxed))
+        {
+            HttpResponse response;
+            response.setStatusCode(HttpResponse::k500InternalServerError);
+            response.setContentType("text/plain");
+            response.setBody("500 Internal Server Error");
+            complete(&response);
+        }
+    }
+
+    ResponseCompletion(const ResponseCompletion &) = delete;
+    ResponseCompletion &operator=(const ResponseCompletion &) = delete;
+
+    const HttpRequest &request() const { return request_->request; }
+
+    // 重复调用时忽略后面的调用
+    void complete(HttpResponse *response)
+    {
+        if (completed_.exchange(true))
+        {
+            return;
+        }
+        finisher_(request_, response);
+    }
+
+private:
+    DetachedRequestPtr request_;
+    Finisher finisher_;
+    std::atomic<bool> completed_;
+};
+
+using ResponseCompletionPtr = std::shared_ptr<ResponseCompletion>;
@@ -0,0 +1,153 @@
+// Awaitables.h
+#pragma once
+
+#include "Task.h"
+#include "WorkStealingPool.h"
+#include "cc_muduo/EventLoop.h"
+
+#include <coroutine>
+#include <exception>
+#include <fcntl.h>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <unistd.h>
+#include <utility>
+
+// 协程运行所在 IO 线程的环境，由 HttpServer 在线程初始化回调中设置。
+// 所有等待操作都通过 loop 恢复协程，协程始终在所属 IO 线程上执行
+struct CoroutineEnv
+{
+    EventLoop *loop = nullptr;
+    WorkStealingPool *pool = nullptr; // 为空时 offload 直接在当前线程执行
+
+    static CoroutineEnv &current()
+    {
+        thread_local CoroutineEnv env;
+        return env;
+    }
+};
+
+// co_await sleepFor(0.5)：定时器到期后在本线程恢复，不阻塞 EventLoop
+class SleepAwaiter
+{
+public:
+    explicit SleepAwaiter(double seconds) : seconds_(seconds) {}
+
+    bool await_ready() const noexcept { return seconds_ <= 0; }
+
+    void await_suspend(std::coroutine_handle<> handle)
+    {
+        CoroutineEnv::current().loop->runAfter(seconds_, [handle]()
+                                               { handle.resume(); });
+    }
+
+    void await_resume() const noexcept {}
+
+private:
+    double seconds_;
+};
+
+inline SleepAwaiter sleepFor(double seconds)
+{
+    return SleepAwaiter(seconds);
+}
+
+// co_await offload(fn)：fn 在工作线程池中执行，完成后回到原 IO 线程恢复，返回 fn 的结果。
+// fn 抛出的异常在 co_await 处重新抛出
+template <typename F>
+class OffloadAwaiter
+{
+public:
+    using Result = std::invoke_result_t<F>;
+
+    explicit OffloadAwaiter(F fn) : fn_(std::move(fn)) {}
+
+    bool await_ready() const noexcept { return CoroutineEnv::current().pool == nullptr; }
+
+    void await_suspend(std::coroutine_handle<> handle)
+    {
+        EventLoop *loop = CoroutineEnv::current().loop;
+        CoroutineEnv::current().pool->submit([this, loop, handle]()
+                                             {
+                                                 run();
+                                                 loop->queueInLoop([handle]()
+                                                                   { handle.resume(); }); });
+    }
+
+    Result await_resume()
+    {
+        if (!done_)
+        {
+            // 没有工作线程池，直接在当前线程执行
+            run();
+        }
+        if (error_)
+        {
+            std::rethrow_exception(error_);
+        }
+        if constexpr (!std::is_void_v<Result>)
+        {
+            return std::move(*result_);
+        }
+    }
+
+private:
+    void run()
+    {
+        try
+        {
+            if constexpr (std::is_void_v<Result>)
+            {
+                fn_();
+            }
+            else
+            {
+                result_.emplace(fn_());
+            }
+        }
+        catch (...)
+        {
+            error_ = std::current_exception();
+        }
+        done_ = true;
+    }
+
+    F fn_;
+    std::optional<std::conditional_t<std::is_void_v<Result>, char, Result>> result_;
+    std::exception_ptr error_;
+    bool done_ = false;
+};
+
+template <typename F>
+OffloadAwaiter<F> offload(F fn)
+{
+    return OffloadAwaiter<F>(std::move(fn));
+}
+
+// 在工作线程池中读取整个文件，文件不存在或读取失败时返回空
+inline Task<std::optional<std::string>> readFile(std::string path)
+{
+    // path 保存在协程帧中，工作线程执行期间一直有效
+    std::optional<std::string> content = co_await offload([&path]() -> std::optional<std::string>
+                               {
+                                   int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+                                   if (fd < 0)
+                                   {
+                                       return std::nullopt;
+                                   }
+                                   std::string content;
+                                   char buf[64 * 1024];
+                                   ssize_t n;
+                                   while ((n = ::read(fd, buf, sizeof buf)) > 0)
+                                   {
+                                       content.append(buf, static_cast<size_t>(n));
+                                   }
+                                   ::close(fd);
+                                   if (n < 0)
+                                   {
+                                       return std::nullopt;
+                                   }
+                                   return content; });
+    co_return content;
+}
@@ -0,0 +1,42 @@
+// BodyStream.h
+#pragma once
+
+#include "HttpRequest.h"
+#include "HttpResponse.h"
+
+#include <functional>
+#include <memory>
+#include <string_view>
+
+// 流式接收的请求体：请求头到达后由路由创建，请求体（已去掉 chunked 编码）每到达一段就交给 onBodyChunk，
+// 不在连接缓冲区中积累，适合大文件上传。所有回调都在连接所属的 IO 线程执行
+class BodyStream
+{
+public:
+    virtual ~BodyStream() = default;
+
+    // 收到一段请求体，data 只在回调期间有效。
+    // 返回 false 时暂停读取连接，直到调用 resume；暂停期间不计请求体超时
+    virtual bool onBodyChunk(std::string_view data) = 0;
+
+    // 请求体全部到达，填写响应
+    virtual void onBodyEnd(HttpResponse *response) = 0;
+
+    // 请求体没能完整到达：连接断开、超时、格式错误或超过大小上限，之后不再有回调
+    virtual void onBodyAbort() {}
+
+    // 恢复被 onBodyChunk 暂停的读取，可以在任意线程调用，在 onBodyChunk 中调用也不会重入
+    void resume()
+    {
+        if (resume_)
+        {
+            resume_();
+        }
+    }
+
+private:
+    friend class HttpServer;
+    std::function<void()> resume_;
+};
+
+using BodyStreamPtr = std::unique_ptr<BodyStream>;
@@ -0,0 +1,169 @@
+// ChunkedDecoder.h
+#pragma once
+
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+// chunked 编码的增量解码器：每次传入新到达的字节，数据段依次交给 sink，
+// 只记住当前所处的状态，不缓存输入。服务端解析请求体和 HttpFetch 接收上游响应共用
+class ChunkedDecoder
+{
+public:
+    enum Result
+    {
+        kOk,              // 最后一块和 trailer 都已收到
+        kNotComplete,     // 需要更多数据
+        kBadChunk,        // 格式错误
+        kBodyTooLarge,    // 数据总量超过 bodyLimit
+        kTrailerTooLarge  // trailer 超过 trailerLimit
+    };
+
+    ChunkedDecoder() { reset(SIZE_MAX, 0); }
+
+    // 开始解码新的消息体
+    void reset(size_t bodyLimit, size_t trailerLimit)
+    {
+        state_ = kSize;
+        remaining_ = 0;
+        received_ = 0;
+        trailerBytes_ = 0;
+        bodyLimit_ = bodyLimit;
+        trailerLimit_ = trailerLimit;
+    }
+
+    // 请求体改为流式接收时放宽上限
+    void setBodyLimit(size_t bodyLimit) { bodyLimit_ = bodyLimit; }
+
+    bool done() const { return state_ == kDone; }
+
+    // [begin, end) 从第一个还没处理的字节开始，数据段交给 sink(const char *data, size_t n)，
+    // sink 返回 false 时在该段之后停止。*consumed 为处理掉的字节数
+    template <typename Sink>
+    Result decode(const char *begin, const char *end, size_t *consumed, Sink &&sink)
+    {
+        const char *p = begin;
+        while (state_ != kDone)
+        {
+            if (state_ == kData)
+            {
+                if (p == end)
+                {
+                    break;
+                }
+                size_t n = remaining_ < static_cast<size_t>(end - p) ? remaining_ : static_cast<size_t>(end - p);
+                const char *data = p;
+                p += n;
+                remaining_ -= n;
+                if (remaining_ == 0)
+                {
+                    state_ = kDataEnd;
+                }
+                if (!sink(data, n))
+                {
+                    break;
+                }
+                continue;
+            }
+
+            // 其余状态都按行处理：块大小行、块数据之后的空行、trailer
+            const char *lineEnd = static_cast<const char *>(std::memchr(p, '\n', static_cast<size_t>(end - p)));
+            if (lineEnd == nullptr)
+            {
+                size_t lineLimit = state_ == kTrailer ? trailerLimit_ - trailerBytes_ : kMaxChunkLine;
+                if (static_cast<size_t>(end - p) > lineLimit)
+                {
+                    *consumed = static_cast<size_t>(p - begin);
+                    return state_ == kTrailer ? kTrailerTooLarge : kBadChunk;
+                }
+                break;
+            }
+            const char *contentEnd = lineEnd > p && lineEnd[-1] == '\r' ? lineEnd - 1 : lineEnd;
+            std::string_view line(p, static_cast<size_t>(contentEnd - p));
+            p = lineEnd + 1;
+
+            Result result = kNotComplete;
+            if (state_ == kDataEnd)
+            {
+                if (!line.empty())
+                {
+                    result = kBadChunk;
+                }
+                state_ = kSize;
+            }
+            else if (state_ == kSize)
+            {
+                result = parseSize(line);
+            }
+            else if (line.empty())
+            {
+                // trailer 之后的空行，消息体结束
+                state_ = kDone;
+            }
+            else
+            {
+                // trailer 字段不使用，只限制总大小
+                trailerBytes_ += static_cast<size_t>(p - line.data());
+                if (trailerBytes_ > trailerLimit_)
+                {
+                    result = kTrailerTooLarge;
+                }
+            }
+            if (result != kNotComplete)
+            {
+                *consumed = static_cast<size_t>(p - begin);
+                return result;
+            }
+        }
+        *consumed = static_cast<size_t>(p - begin);
+        return state_ == kDone ? kOk : kNotComplete;
+    }
+
+private:
+    enum State
+    {
+        kSize,    // 块大小行
+        kData,    // 块数据
+        kDataEnd, // 块数据之后的 CRLF
+        kTrailer, // 最后一块之后的 trailer 和空行
+        kDone
+    };
+
+    static constexpr size_t kMaxChunkLine = 4096;
+
+    // 块大小为十六进制，之后可以有 ";扩展"，忽略扩展
+    Result parseSize(std::string_view line)
+    {
+        size_t size = 0;
+        auto result = std::from_chars(line.data(), line.data() + line.size(), size, 16);
+        if (result.ec != std::errc() || result.ptr == line.data() ||
+            (result.ptr != line.data() + line.size() && *result.ptr != ';' && *result.ptr != ' ' &&
+             *result.ptr != '\t'))
+        {
+            return kBadChunk;
+        }
+        if (size == 0)
+        {
+            state_ = kTrailer;
+        }
+        else if (size > bodyLimit_ - received_)
+        {
+            return kBodyTooLarge;
+        }
+        else
+        {
+            received_ += size;
+            remaining_ = size;
+            state_ = kData;
+        }
+        return kNotComplete;
+    }
+
+    State state_;
+    size_t remaining_;    // 当前块剩余的字节数
+    size_t received_;     // 已声明的数据总量
+    size_t trailerBytes_;
+    size_t bodyLimit_;
+    size_t trailerLimit_;
+};
@@ -0,0 +1,424 @@
+// Compression.cpp
+#include "Compression.h"
+#include "HttpRequest.h"
+#include "HttpResponse.h"
+
+#include <climits>
+
+#ifdef CC_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef CC_HAVE_BROTLI
+#include <brotli/encode.h>
+#endif
+
+namespace
+{
+    // 流式压缩每次扩展输出的步长
+    constexpr size_t kOutputStep = 16 * 1024;
+
+    std::string_view trim(std::string_view s)
+    {
+        while (!s.empty() && (s.front() == ' ' || s.front() == '\t'))
+            s.remove_prefix(1);
+        while (!s.empty() && (s.back() == ' ' || s.back() == '\t'))
+            s.remove_suffix(1);
+        return s;
+    }
+
+    // 解析 "q=0.5" 形式的参数，格式错误时按 q=1 处理
+    double parseQuality(std::string_view params)
+    {
+        while (!params.empty())
+        {
+            size_t semicolon = params.find(';');
+            std::string_view param = trim(params.substr(0, semicolon));
+            if (param.size() > 2 && (param[0] == 'q' || param[0] == 'Q') && param[1] == '=')
+            {
+                param.remove_prefix(2);
+                double value = 0;
+                double scale = 1;
+                bool fraction = false;
+                for (char c : param)
+                {
+                    if (c == '.' && !fraction)
+                    {
+                        fraction = true;
+                    }
+                    else if (c >= '0' && c <= '9')
+                    {
+                        if (fraction)
+                        {
+                            scale /= 10;
+                            value += (c - '0') * scale;
+                        }
+                        else
+                        {
+                            value = value * 10 + (c - '0');
+                        }
+                    }
+                    else
+                    {
+                        return 1;
+                    }
+                }
+                return value > 1 ? 1 : value;
+            }
+            if (semicolon == std::string_view::npos)
+            {
+                break;
+            }
+            params.remove_prefix(semicolon + 1);
+        }
+        return 1;
+    }
+
+#ifdef CC_HAVE_ZLIB
+    int windowBits(Compression::Encoding encoding)
+    {
+        // 加 16 输出 gzip 格式，否则为 HTTP deflate 使用的 zlib 格式
+        return encoding == Compression::kGzip ? 15 + 16 : 15;
+    }
+#endif
+}
+
+bool Compression::available(Encoding encoding)
+{
+    switch (encoding)
+    {
+    case kIdentity:
+        return true;
+#ifdef CC_HAVE_ZLIB
+    case kGzip:
+    case kDeflate:
+        return true;
+#endif
+#ifdef CC_HAVE_BROTLI
+    case kBrotli:
+        return true;
+#endif
+    default:
+        return false;
+    }
+}
+
+std::string_view Compression::name(Encoding encoding)
+{
+    switch (encoding)
+    {
+    case kGzip:
+        return "gzip";
+    case kDeflate:
+        return "deflate";
+    case kBrotli:
+        return "br";
+    default:
+        return "identity";
+    }
+}
+
+Compression::Encoding Compression::negotiate(std::string_view acceptEncoding)
+{
+    // -1 表示没有出现，由 "*" 决定
+    double quality[kEncodingCount] = {-1, -1, -1, -1};
+    double wildcard = -1;
+
+    while (!acceptEncoding.empty())
+    {
+        size_t comma = acceptEncoding.find(',');
+        std::string_view item = acceptEncoding.substr(0, comma);
+        size_t semicolon = item.find(';');
+        std::string_view coding = trim(item.substr(0, semicolon));
+        double q = semicolon == std::string_view::npos ? 1 : parseQuality(item.substr(semicolon + 1));
+
+        if (HttpRequest::equalsIgnoreCase(coding, "gzip") || HttpRequest::equalsIgnoreCase(coding, "x-gzip"))
+            quality[kGzip] = q;
+        else if (HttpRequest::equalsIgnoreCase(coding, "deflate"))
+            quality[kDeflate] = q;
+        else if (HttpRequest::equalsIgnoreCase(coding, "br"))
+            quality[kBrotli] = q;
+        else if (coding == "*")
+            wildcard = q;
+
+        if (comma == std::string_view::npos)
+        {
+            break;
+        }
+        acceptEncoding.remove_prefix(comma + 1);
+    }
+
+    Encoding best = kIdentity;
+    double bestQuality = 0;
+    for (Encoding encoding : {kBrotli, kGzip, kDeflate})
+    {
+        if (!available(encoding))
+        {
+            continue;
+        }
+        double q = quality[encoding] >= 0 ? quality[encoding] : (wildcard >= 0 ? wildcard : 0);
+        if (q > bestQuality)
+        {
+            best = encoding;
+            bestQuality = q;
+        }
+    }
+    return best;
+}
+
+bool Compression::compress(Encoding encoding, std::string_view input, std::string *output,
+                           const CompressionPolicy &policy)
+{
+    size_t start = output->size();
+    switch (encoding)
+    {
+#ifdef CC_HAVE_ZLIB
+    case kGzip:
+    case kDeflate:
+    {
+        if (input.size() > UINT_MAX)
+        {
+            return false;
+        }
+        z_stream zs{};
+        if (deflateInit2(&zs, policy.level, Z_DEFLATED, windowBits(encoding), 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        {
+            return false;
+        }
+        uLong bound = deflateBound(&zs, static_cast<uLong>(input.size()));
+        output->resize(start + bound);
+        zs.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(input.data()));
+        zs.avail_in = static_cast<uInt>(input.size());
+        zs.next_out = reinterpret_cast<Bytef *>(&(*output)[start]);
+        zs.avail_out = static_cast<uInt>(bound);
+        int rc = deflate(&zs, Z_FINISH);
+        deflateEnd(&zs);
+        if (rc != Z_STREAM_END)
+        {
+            output->resize(start);
+            return false;
+        }
+        output->resize(start + zs.total_out);
+        return true;
+    }
+#endif
+#ifdef CC_HAVE_BROTLI
+    case kBrotli:
+    {
+        size_t bound = BrotliEncoderMaxCompressedSize(input.size());
+        if (bound == 0)
+        {
+            return false;
+        }
+        output->resize(start + bound);
+        size_t size = bound;
+        if (!BrotliEncoderCompress(policy.brotliQuality, BROTLI_DEFAULT_WINDOW, BROTLI_MODE_GENERIC,
+                                   input.size(), reinterpret_cast<const uint8_t *>(input.data()), &size,
+                                   reinterpret_cast<uint8_t *>(&(*output)[start])))
+        {
+            output->resize(start);
+            return false;
+        }
+        output->resize(start + size);
+        return true;
+    }
+#endif
+    default:
+        (void)input;
+        (void)policy;
+        (void)start;
+        return false;
+    }
+}
+
+bool Compression::compressible(const HttpResponse &response, const CompressionPolicy &policy)
+{
+    return response.statusCode() == HttpResponse::k200Ok &&
+           response.getHeader(HttpHeader::kContentEncoding).empty() &&
+           response.getHeader(HttpHeader::kTransferEncoding).empty() &&
+           response.body().size() >= policy.minSize &&
+           policy.compressibleType(response.getHeader(HttpHeader::kContentType));
+}
+
+void Compression::addVary(HttpResponse *response)
+{
+    std::string_view vary = response->getHeader(HttpHeader::kVary);
+    if (vary.empty())
+    {
+        response->addHeader("Vary", "Accept-Encoding");
+    }
+    else if (vary != "*" && !HttpRequest::hasToken(vary, "Accept-Encoding"))
+    {
+        std::string merged(vary);
+        merged += ", Accept-Encoding";
+        response->addHeader("Vary", merged);
+    }
+}
+
+bool Compression::encode(Encoding encoding, HttpResponse *response, const CompressionPolicy &policy)
+{
+    std::string_view body = response->body();
+    std::string compressed;
+    if (!compress(encoding, body, &compressed, policy) || compressed.size() >= body.size())
+    {
+        return false;
+    }
+    response->setBody(std::move(compressed));
+    response->addHeader("Content-Encoding", name(encoding));
+
+    // 同一个资源的不同编码不再逐字节相同，强 ETag 降为弱 ETag
+    std::string_view etag = response->getHeader(HttpHeader::kETag);
+    if (!etag.empty() && etag.substr(0, 2) != "W/")
+    {
+        std::string weak("W/");
+        weak.append(etag.data(), etag.size());
+        response->addHeader("ETag", weak);
+    }
+    return true;
+}
+
+void Compression::apply(const HttpRequest &request, HttpResponse *response, const CompressionPolicy &policy)
+{
+    if (!compressible(*response, policy))
+    {
+        return;
+    }
+    addVary(response);
+    Encoding encoding = negotiate(request.getHeader(HttpHeader::kAcceptEncoding));
+    if (encoding != kIdentity)
+    {
+        encode(encoding, response, policy);
+    }
+}
+
+Compression::Stream::Stream(Encoding encoding, const CompressionPolicy &policy)
+    : encoding_(encoding), state_(nullptr)
+{
+    switch (encoding)
+    {
+#ifdef CC_HAVE_ZLIB
+    case kGzip:
+    case kDeflate:
+    {
+        z_stream *zs = new z_stream{};
+        if (deflateInit2(zs, policy.level, Z_DEFLATED, windowBits(encoding), 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        {
+            delete zs;
+            zs = nullptr;
+        }
+        state_ = zs;
+        break;
+    }
+#endif
+#ifdef CC_HAVE_BROTLI
+    case kBrotli:
+    {
+        BrotliEncoderState *state = BrotliEncoderCreateInstance(nullptr, nullptr, nullptr);
+        if (state != nullptr)
+        {
+            BrotliEncoderSetParameter(state, BROTLI_PARAM_QUALITY, static_cast<uint32_t>(policy.brotliQuality));
+        }
+        state_ = state;
+        break;
+    }
+#endif
+    default:
+        (void)policy;
+        break;
+    }
+}
+
+Compression::Stream::~Stream()
+{
+    if (state_ == nullptr)
+    {
+        return;
+    }
+#ifdef CC_HAVE_ZLIB
+    if (encoding_ == kGzip || encoding_ == kDeflate)
+    {
+        z_stream *zs = static_cast<z_stream *>(state_);
+        deflateEnd(zs);
+        delete zs;
+    }
+#endif
+#ifdef CC_HAVE_BROTLI
+    if (encoding_ == kBrotli)
+    {
+        BrotliEncoderDestroyInstance(static_cast<BrotliEncoderState *>(state_));
+    }
+#endif
+}
+
+bool Compression::Stream::write(std::string_view input, std::string *output)
+{
+    return run(input, false, output);
+}
+
+bool Compression::Stream::finish(std::string *output)
+{
+    return run(std::string_view(), true, output);
+}
+
+bool Compression::Stream::run(std::string_view input, bool finish, std::string *output)
+{
+    if (state_ == nullptr)
+    {
+        return false;
+    }
+#ifdef CC_HAVE_ZLIB
+    if (encoding_ == kGzip || encoding_ == kDeflate)
+    {
+        if (input.size() > UINT_MAX)
+        {
+            return false;
+        }
+        z_stream *zs = static_cast<z_stream *>(state_);
+        zs->next_in = reinterpret_cast<Bytef *>(const_cast<char *>(input.data()));
+        zs->avail_in = static_cast<uInt>(input.size());
+        int rc;
+        do
+        {
+            size_t start = output->size();
+            output->resize(start + kOutputStep);
+            zs->next_out = reinterpret_cast<Bytef *>(&(*output)[start]);
+            zs->avail_out = static_cast<uInt>(kOutputStep);
+            rc = deflate(zs, finish ? Z_FINISH : Z_NO_FLUSH);
+            output->resize(start + kOutputStep - zs->avail_out);
+            if (rc == Z_STREAM_ERROR)
+            {
+                return false;
+            }
+        } while (zs->avail_out == 0 || (finish ? rc != Z_STREAM_END : zs->avail_in > 0));
+        return true;
+    }
+#endif
+#ifdef CC_HAVE_BROTLI
+    if (encoding_ == kBrotli)
+    {
+        BrotliEncoderState *state = static_cast<BrotliEncoderState *>(state_);
+        size_t availableIn = input.size();
+        const uint8_t *nextIn = reinterpret_cast<const uint8_t *>(input.data());
+        do
+        {
+            size_t start = output->size();
+            output->resize(start + kOutputStep);
+            size_t availableOut = kOutputStep;
+            uint8_t *nextOut = reinterpret_cast<uint8_t *>(&(*output)[start]);
+            if (!BrotliEncoderCompressStream(state, finish ? BROTLI_OPERATION_FINISH : BROTLI_OPERATION_PROCESS,
+                                             &availableIn, &nextIn, &availableOut, &nextOut, nullptr))
+            {
+                output->resize(start);
+                return false;
+            }
+            output->resize(start + kOutputStep - availableOut);
+        } while (availableIn > 0 || BrotliEncoderHasMoreOutput(state) ||
+                 (finish && !BrotliEncoderIsFinished(state)));
+        return true;
+    }
+#endif
+    (void)input;
+    (void)finish;
+    (void)output;
+    return false;
+}
@@ -0,0 +1,100 @@
+// Compression.h
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class HttpRequest;
+class HttpResponse;
+
+// 响应压缩策略
+struct CompressionPolicy
+{
+    size_t minSize = 1024;             // 小于此大小的响应体不压缩
+    int level = 6;                     // gzip / deflate 压缩级别 1-9
+    int brotliQuality = 5;             // brotli 质量 0-11
+    size_t maxBufferedSize = 1 << 20;  // 静态文件不超过此大小时整体压缩并缓存，否则发送时流式压缩
+    std::vector<std::string> contentTypes = {
+        "text/",
+        "application/json",
+        "application/javascript",
+        "application/xml",
+        "image/svg+xml",
+    }; // 按前缀匹配 Content-Type
+
+    bool compressibleType(std::string_view contentType) const
+    {
+        for (const auto &prefix : contentTypes)
+        {
+            if (contentType.substr(0, prefix.size()) == prefix)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+// gzip / deflate 使用 zlib（CC_HAVE_ZLIB），br 使用 brotli（CC_HAVE_BROTLI），
+// 编译时没有对应的库时该编码不可用，协商时不会选中
+class Compression
+{
+public:
+    enum Encoding
+    {
+        kIdentity,
+        kGzip,
+        kDeflate,
+        kBrotli,
+        kEncodingCount
+    };
+
+    static bool available(Encoding encoding);
+
+    // Content-Encoding 中的名字
+    static std::string_view name(Encoding encoding);
+
+    // 按 Accept-Encoding 的 q 值选择可用的编码，q 值相同时依次优先 br、gzip、deflate
+    static Encoding negotiate(std::string_view acceptEncoding);
+
+    // 一次性压缩 input 追加到 output，失败时返回 false
+    static bool compress(Encoding encoding, std::string_view input, std::string *output,
+                         const CompressionPolicy &policy);
+
+    // 响应是否适合压缩：200、没有 Content-Encoding 和 Transfer-Encoding、类型匹配且足够大
+    static bool compressible(const HttpResponse &response, const CompressionPolicy &policy);
+
+    // 在 Vary 头部中加入 Accept-Encoding
+    static void addVary(HttpResponse *response);
+
+    // 把响应体替换为压缩后的内容并设置 Content-Encoding，强 ETag 改为弱 ETag。
+    // 压缩后没有变小时保持原样并返回 false
+    static bool encode(Encoding encoding, HttpResponse *response, const CompressionPolicy &policy);
+
+    // 动态响应的压缩阶段：根据请求的 Accept-Encoding 压缩可压缩的响应
+    static void apply(const HttpRequest &request, HttpResponse *response, const CompressionPolicy &policy);
+
+    // 流式压缩器，用于发送时分块压缩的大文件
+    class Stream
+    {
+    public:
+        Stream(Encoding encoding, const CompressionPolicy &policy);
+        ~Stream();
+
+        Stream(const Stream &) = delete;
+        Stream &operator=(const Stream &) = delete;
+
+        // 压缩一块输入追加到 output，压缩器可能暂存数据而不产生输出
+        bool write(std::string_view input, std::string *output);
+        // 输出剩余数据和结尾
+        bool finish(std::string *output);
+
+    private:
+        bool run(std::string_view input, bool finish, std::string *output);
+
+        Encoding encoding_;
+        void *state_; // z_stream 或 BrotliEncoderState
+    };
+};
@@ -0,0 +1,163 @@
+// DemoRoutes.cpp
+#include "DemoRoutes.h"
+#include "Awaitables.h"
+#include "HttpServer.h"
+
+#include <memory>
+#include <string>
+
+namespace
+{
+    // /upload 的请求体只统计字节数
+    class UploadCounter : public BodyStream
+    {
+    public:
+        bool onBodyChunk(std::string_view data) override
+        {
+            bytes_ += data.size();
+            return true;
+        }
+
+        void onBodyEnd(HttpResponse *resp) override
+        {
+            resp->setStatusCode(HttpResponse::k200Ok);
+            resp->setContentType("text/plain");
+            resp->setBody({"Received ", std::to_string(bytes_), " bytes"});
+        }
+
+    private:
+        uint64_t bytes_ = 0;
+    };
+}
+
+void configureDemoServer(HttpServer &server)
+{
+    // 启用性能监控
+    server.enablePerformanceMonitoring(true);
+
+    // 过载保护：限制连接数和处理中的异步请求数，慢客户端的输出积压超过 1MB 时暂停读取
+    server.setMaxConnections(10000);
+    server.setMaxInflightRequests(1024);
+    server.setOutputHighWaterMark(1 << 20);
+
+    // 上传占用带宽最多，每个客户端 IP 每秒最多 10 个，允许 20 个的突发。
+    // 其余路由不限流，回环压测不会被 429 拒绝
+    {
+        RateLimitPolicy policy;
+        policy.rate = 10;
+        policy.burst = 20;
+        server.addRateLimit("/upload", policy);
+    }
+
+    // 按 Accept-Encoding 压缩文本响应
+    server.enableCompression();
+
+    registerDemoRoutes(server);
+}
+
+void registerDemoRoutes(HttpServer &server)
+{
+    // 固定内容的页面在启动时序列化一次
+    {
+        // 构造包含大文字和玫瑰花的 HTML 响应
+        HttpResponse index;
+        index.setStatusCode(HttpResponse::k200Ok);
+        index.setContentType("text/html");
+        index.setBody(R"(
+        <html>
+        <head>
+            <meta charset="UTF-8">
+            <style>
+                body {
+                    text-align: center;
+                    font-family: Arial, sans-serif;
+                    background-color: #f8f8f8;
+                    padding: 50px;
+                }
+                h1 {
+                    font-size: 80px;
+                    color: #ff6347;
+                    text-shadow: 2px 2px 5px rgba(0, 0, 0, 0.3);
+                }
+                .rose {
+                    font-size: 50px;
+                    color: red;
+                }
+                .message {
+                    font-size: 40px;
+                    color: #ff69b4;
+                    margin-top: 20px;
+                }
+                .rose-icon {
+                    font-size: 100px;
+                    color: red;
+                }
+            </style>
+        </head>
+        <body>
+            <h1>你是人机</h1>
+            <div class='rose'>
+                <span class="rose-icon">&#127801;</span> <!-- 玫瑰花图标 -->
+            </div>
+            <div class='message'>
+                欢迎使用 cc_WebServer
+            </div>
+        </body>
+        </html>
+    )");
+        server.getStatic("/", index);
+    }
+
+    {
+        HttpResponse hello;
+        hello.setStatusCode(HttpResponse::k200Ok);
+        hello.setContentType("text/plain");
+        hello.setBody("Hello, World!");
+        server.getStatic("/hello", hello);
+    }
+
+    {
+        // 返回一个空的 favicon.ico
+        HttpResponse favicon;
+        favicon.setStatusCode(HttpResponse::k200Ok);
+        favicon.setContentType("image/x-icon");
+        server.getStatic("/favicon.ico", favicon);
+    }
+
+    server.post("/echo", [](const HttpRequest &req, HttpResponse *resp)
+                {
+        resp->setStatusCode(HttpResponse::k200Ok);
+        resp->setContentType("text/plain");
+        resp->setBody({"You sent: ", req.body()}); });
+
+    // 异步路由：处理函数在工作线程池中执行，不阻塞 IO 线程
+    server.postAsync("/echo-async", [](const HttpRequest &req, ResponseCompletionPtr done)
+                     {
+        HttpResponse resp;
+        resp.setStatusCode(HttpResponse::k200Ok);
+        resp.setContentType("text/plain");
+        resp.setBody({"You sent: ", req.body()});
+        done->complete(&resp); });
+
+    // 协程路由：等待期间 IO 线程继续处理其他连接
+    server.getCoroutine("/delay", [](const HttpRequest &) -> Task<HttpResponse>
+                        {
+        co_await sleepFor(0.1);
+        HttpResponse resp;
+        resp.setStatusCode(HttpResponse::k200Ok);
+        resp.setContentType("text/plain");
+        resp.setBody("Delayed 100ms");
+        co_return resp; });
+
+    // 流式上传：请求体边到达边处理，不在内存中缓存
+    server.postStream("/upload", [](const HttpRequest &, HttpResponse *) -> BodyStreamPtr
+                      { return std::make_unique<UploadCounter>(); });
+    
+    // 性能监控路由
+    server.get("/monitor", [&server](const HttpRequest &, HttpResponse *resp)
+               {
+                   std::string report = server.getPerformanceReport();
+                   resp->setStatusCode(HttpResponse::k200Ok);
+                   resp->setContentType("text/plain");
+                   resp->setBody(std::move(report)); });
+}
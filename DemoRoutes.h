@@ -0,0 +1,11 @@
+// DemoRoutes.h
+#pragma once
+
+class HttpServer;
+
+// 示例服务的配置：性能监控、过载保护、限流、压缩和全部路由。
+// HttpServer 主程序和 HttpBench 的内嵌模式共用，保证压测的就是实际部署的配置。线程数由调用方设置
+void configureDemoServer(HttpServer &server);
+
+// 示例服务的全部路由
+void registerDemoRoutes(HttpServer &server);
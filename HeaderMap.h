@@ -0,0 +1,234 @@
+// HeaderMap.h
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <strings.h>
+#include <vector>
+
+// 常用头部的编号，HeaderMap 按编号记录其位置，查找时不需要逐个比较名字
+class HttpHeader
+{
+public:
+    enum Known : uint8_t
+    {
+        kOther,
+        kAcceptEncoding,
+        kConnection,
+        kContentEncoding,
+        kContentLength,
+        kContentType,
+        kDate,
+        kETag,
+        kExpect,
+        kHost,
+        kIfModifiedSince,
+        kIfNoneMatch,
+        kRange,
+        kReferer,
+        kTransferEncoding,
+        kUserAgent,
+        kVary,
+        kKnownCount
+    };
+
+    static constexpr std::string_view name(Known known)
+    {
+        return kNames[known];
+    }
+
+    // 忽略大小写识别常用头部，先按长度过滤，最多比较一两次
+    static Known classify(std::string_view header)
+    {
+        for (int i = 1; i < kKnownCount; ++i)
+        {
+            std::string_view candidate = name(static_cast<Known>(i));
+            if (candidate.size() == header.size() && equalsIgnoreCase(candidate, header))
+            {
+                return static_cast<Known>(i);
+            }
+        }
+        return kOther;
+    }
+
+    static bool equalsIgnoreCase(std::string_view a, std::string_view b)
+    {
+        return a.size() == b.size() && ::strncasecmp(a.data(), b.data(), a.size()) == 0;
+    }
+
+private:
+    // 类作用域的静态表：作为 name() 的局部常量时每次调用都会在栈上重新构造
+    static constexpr std::string_view kNames[kKnownCount] = {
+        "",
+        "Accept-Encoding",
+        "Connection",
+        "Content-Encoding",
+        "Content-Length",
+        "Content-Type",
+        "Date",
+        "ETag",
+        "Expect",
+        "Host",
+        "If-Modified-Since",
+        "If-None-Match",
+        "Range",
+        "Referer",
+        "Transfer-Encoding",
+        "User-Agent",
+        "Vary",
+    };
+};
+
+// 扁平的头部容器：前 16 个头部存放在对象内部，超过后整体搬到堆上。
+// 名字比较忽略大小写，常用头部通过 HttpHeader::Known 编号 O(1) 定位。
+// 名字和值只保存视图，由使用者保证数据有效：请求指向连接缓冲区，响应指向 Arena
+class HeaderMap
+{
+public:
+    static constexpr size_t kInlineCapacity = 16;
+
+    struct Entry
+    {
+        std::string_view name;
+        std::string_view value;
+        HttpHeader::Known known = HttpHeader::kOther;
+    };
+
+    HeaderMap() : size_(0), spilled_(false) { index_.fill(0); }
+
+    // 追加一个头部，允许重名
+    void add(std::string_view name, std::string_view value)
+    {
+        append(name, value, HttpHeader::classify(name));
+    }
+
+    // 设置头部，已存在同名头部时替换第一个的值
+    void set(std::string_view name, std::string_view value)
+    {
+        HttpHeader::Known known = HttpHeader::classify(name);
+        Entry *entry = find(*this, name, known);
+        if (entry != nullptr)
+        {
+            entry->value = value;
+        }
+        else
+        {
+            append(name, value, known);
+        }
+    }
+
+    // 返回第一个同名头部的值，不存在时返回空
+    std::string_view get(std::string_view name) const
+    {
+        const Entry *entry = find(*this, name, HttpHeader::classify(name));
+        return entry != nullptr ? entry->value : std::string_view();
+    }
+
+    std::string_view get(HttpHeader::Known known) const
+    {
+        uint16_t position = index_[known];
+        return position != 0 ? data()[position - 1].value : std::string_view();
+    }
+
+    bool contains(HttpHeader::Known known) const { return index_[known] != 0; }
+
+    bool contains(std::string_view name) const
+    {
+        return find(*this, name, HttpHeader::classify(name)) != nullptr;
+    }
+
+    // 同名头部出现的次数
+    size_t count(HttpHeader::Known known) const
+    {
+        size_t n = 0;
+        for (const Entry &entry : *this)
+        {
+            n += entry.known == known;
+        }
+        return n;
+    }
+
+    Entry *begin() { return data(); }
+    Entry *end() { return data() + size_; }
+    const Entry *begin() const { return data(); }
+    const Entry *end() const { return data() + size_; }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    // 回到内部存储
+    void clear()
+    {
+        size_ = 0;
+        index_.fill(0);
+        if (spilled_)
+        {
+            spilled_ = false;
+            heap_.clear();
+        }
+    }
+
+private:
+    Entry *data() { return spilled_ ? heap_.data() : inline_.data(); }
+    const Entry *data() const { return spilled_ ? heap_.data() : inline_.data(); }
+
+    // const 和非 const 版本共用
+    template <typename Self>
+    static auto find(Self &self, std::string_view name, HttpHeader::Known known) -> decltype(self.data())
+    {
+        if (known != HttpHeader::kOther)
+        {
+            uint16_t position = self.index_[known];
+            return position != 0 ? &self.data()[position - 1] : nullptr;
+        }
+        for (auto &entry : self)
+        {
+            if (entry.known == HttpHeader::kOther && HttpHeader::equalsIgnoreCase(entry.name, name))
+            {
+                return &entry;
+            }
+        }
+        return nullptr;
+    }
+
+    void append(std::string_view name, std::string_view value, HttpHeader::Known known)
+    {
+        Entry *entry;
+        if (!spilled_ && size_ < kInlineCapacity)
+        {
+            entry = &inline_[size_];
+        }
+        else
+        {
+            if (!spilled_)
+            {
+                // 内部存储已满，整体搬到堆上，保持连续存储
+                heap_.reserve(kInlineCapacity * 2);
+                heap_.resize(kInlineCapacity);
+                for (size_t i = 0; i < kInlineCapacity; ++i)
+                {
+                    heap_[i] = inline_[i];
+                }
+                spilled_ = true;
+            }
+            heap_.emplace_back();
+            entry = &heap_.back();
+        }
+        entry->name = name;
+        entry->value = value;
+        entry->known = known;
+        ++size_;
+        if (known != HttpHeader::kOther && index_[known] == 0)
+        {
+            index_[known] = static_cast<uint16_t>(size_);
+        }
+    }
+
+    std::array<Entry, kInlineCapacity> inline_;
+    std::vector<Entry> heap_;
+    std::array<uint16_t, HttpHeader::kKnownCount> index_; // 常用头部第一次出现的位置 + 1，0 表示不存在
+    size_t size_;
+    bool spilled_;
+};
@@ -0,0 +1,274 @@
+// HttpClient.cpp
+#include "HttpClient.h"
+#include "Awaitables.h"
+#include "HttpRequest.h"
+
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <sys/socket.h>
+#include <unistd.h>
+
+std::string_view UpstreamResponse::header(std::string_view name) const
+{
+    std::string_view rest(head);
+    size_t lineEnd = rest.find("\r\n");
+    while (lineEnd != std::string_view::npos)
+    {
+        rest.remove_prefix(lineEnd + 2);
+        lineEnd = rest.find("\r\n");
+        std::string_view line = rest.substr(0, lineEnd);
+        size_t colon = line.find(':');
+        if (colon != std::string_view::npos && HttpRequest::equalsIgnoreCase(line.substr(0, colon), name))
+        {
+            std::string_view value = line.substr(colon + 1);
+            while (!value.empty() && (value.front() == ' ' || value.front() == '\t'))
+                value.remove_prefix(1);
+            while (!value.empty() && (value.back() == ' ' || value.back() == '\t'))
+                value.remove_suffix(1);
+            return value;
+        }
+    }
+    return std::string_view();
+}
+
+HttpFetch::HttpFetch(const InetAddress &server, std::string request, double timeoutSeconds)
+    : server_(server), request_(std::move(request)), timeout_(timeoutSeconds)
+{
+}
+
+HttpFetch::~HttpFetch()
+{
+    // 协程恢复之后才析构，此时 Channel 已从 EventLoop 中移除，也不在回调之中
+    channel_.reset();
+    if (fd_ >= 0)
+    {
+        ::close(fd_);
+    }
+}
+
+void HttpFetch::await_suspend(std::coroutine_handle<> handle)
+{
+    handle_ = handle;
+    loop_ = CoroutineEnv::current().loop;
+
+    fd_ = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd_ < 0)
+    {
+        finish(std::string("socket: ") + strerror(errno));
+        return;
+    }
+    const sockaddr_in *addr = server_.getSockAddr();
+    if (::connect(fd_, reinterpret_cast<const sockaddr *>(addr), sizeof *addr) < 0 && errno != EINPROGRESS)
+    {
+        finish(std::string("connect: ") + strerror(errno));
+        return;
+    }
+
+    channel_ = std::make_unique<Channel>(loop_, fd_);
+    channel_->setWriteCallback([this]()
+                               { onWritable(); });
+    channel_->setReadCallback([this](Timestamp)
+                              { onReadable(); });
+    channel_->setCloseCallback([this]()
+                               { onReadable(); });
+    channel_->setErrorCallback([this]()
+                               { finish("socket error"); });
+    channel_->enableWriting();
+
+    if (timeout_ > 0)
+    {
+        timer_ = loop_->runAfter(timeout_, [this]()
+                                 { onTimeout(); });
+    }
+}
+
+void HttpFetch::onWritable()
+{
+    if (!connected_)
+    {
+        int err = 0;
+        socklen_t len = sizeof err;
+        ::getsockopt(fd_, SOL_SOCKET, SO_ERROR, &err, &len);
+        if (err != 0)
+        {
+            finish(std::string("connect: ") + strerror(err));
+            return;
+        }
+        connected_ = true;
+    }
+
+    while (written_ < request_.size())
+    {
+        ssize_t n = ::write(fd_, request_.data() + written_, request_.size() - written_);
+        if (n < 0)
+        {
+            if (errno == EAGAIN || errno == EINTR)
+            {
+                return;
+            }
+            finish(std::string("write: ") + strerror(errno));
+            return;
+        }
+        written_ += static_cast<size_t>(n);
+    }
+
+    channel_->disableWriting();
+    channel_->enableReading();
+}
+
+void HttpFetch::onReadable()
+{
+    if (finished_)
+    {
+        return;
+    }
+    char buf[64 * 1024];
+    for (;;)
+    {
+        ssize_t n = ::read(fd_, buf, sizeof buf);
+        if (n > 0)
+        {
+            input_.append(buf, static_cast<size_t>(n));
+            continue;
+        }
+        if (n == 0)
+        {
+            if (!tryComplete(true))
+            {
+                finish("connection closed before the response was complete");
+            }
+            return;
+        }
+        if (errno == EINTR)
+        {
+            continue;
+        }
+        if (errno == EAGAIN)
+        {
+            tryComplete(false);
+            return;
+        }
+        finish(std::string("read: ") + strerror(errno));
+        return;
+    }
+}
+
+void HttpFetch::onTimeout()
+{
+    timerFired_ = true;
+    finish("timeout");
+}
+
+bool HttpFetch::tryComplete(bool eof)
+{
+    // 头部不完整，或者状态行格式错误时 parseHead 已经 finish
+    if (!headParsed_ && !parseHead())
+    {
+        return finished_;
+    }
+
+    std::string_view body(input_);
+    if (chunked_)
+    {
+        // 每次只解码新到达的字节，收到最后一块和 trailer 就完成，不依赖对端关闭连接
+        size_t consumed = 0;
+        ChunkedDecoder::Result result = chunkDecoder_.decode(body.data(), body.data() + body.size(), &consumed,
+                                                             [this](const char *data, size_t n)
+                                                             {
+                                                                 response_.body.append(data, n);
+                                                                 return true;
+                                                             });
+        input_.erase(0, consumed);
+        if (result == ChunkedDecoder::kNotComplete)
+        {
+            return false;
+        }
+        if (result != ChunkedDecoder::kOk)
+        {
+            finish("malformed chunked body");
+            return true;
+        }
+    }
+    else if (hasContentLength_)
+    {
+        if (body.size() < contentLength_)
+        {
+            return false;
+        }
+        response_.body.assign(body.data(), contentLength_);
+    }
+    else
+    {
+        // 没有长度信息，以连接关闭为结束
+        if (!eof)
+        {
+            return false;
+        }
+        response_.body.assign(body.data(), body.size());
+    }
+
+    response_.ok = true;
+    finish(std::string());
+    return true;
+}
+
+bool HttpFetch::parseHead()
+{
+    size_t headEnd = input_.find("\r\n\r\n");
+    if (headEnd == std::string::npos)
+    {
+        return false;
+    }
+
+    std::string_view head(input_.data(), headEnd);
+    // 状态行："HTTP/1.1 200 OK"
+    size_t space = head.find(' ');
+    if (space == std::string_view::npos || head.substr(0, 5) != "HTTP/")
+    {
+        finish("malformed status line");
+        return false;
+    }
+    std::from_chars(head.data() + space + 1, head.data() + head.size(), response_.status);
+
+    response_.head.assign(head.data(), head.size());
+    input_.erase(0, headEnd + 4);
+    headParsed_ = true;
+    std::string_view contentLength = response_.header("Content-Length");
+    chunked_ = HttpRequest::hasToken(response_.header("Transfer-Encoding"), "chunked");
+    if (chunked_)
+    {
+        chunkDecoder_.reset(SIZE_MAX, kMaxTrailerBytes);
+    }
+    else if (!contentLength.empty())
+    {
+        hasContentLength_ = true;
+        std::from_chars(contentLength.data(), contentLength.data() + contentLength.size(), contentLength_);
+    }
+    return true;
+}
+
+void HttpFetch::finish(std::string error)
+{
+    if (finished_)
+    {
+        return;
+    }
+    finished_ = true;
+    response_.error = std::move(error);
+
+    if (timeout_ > 0 && !timerFired_ && channel_)
+    {
+        loop_->cancel(timer_);
+    }
+    if (channel_)
+    {
+        channel_->disableAll();
+        channel_->remove();
+    }
+
+    // 可能正处于 Channel 的回调中，推迟到下一轮再恢复协程，协程恢复后本对象随之销毁
+    std::coroutine_handle<> handle = handle_;
+    loop_->queueInLoop([handle]()
+                       { handle.resume(); });
+}
@@ -0,0 +1,88 @@
+// HttpClient.h
+#pragma once
+
+#include "ChunkedDecoder.h"
+#include "cc_muduo/Channel.h"
+#include "cc_muduo/EventLoop.h"
+#include "cc_muduo/InetAddress.h"
+#include "cc_muduo/TimerId.h"
+
+#include <coroutine>
+#include <memory>
+#include <string>
+#include <string_view>
+
+// 上游服务器的响应
+struct UpstreamResponse
+{
+    bool ok = false;   // 是否收到完整的响应
+    std::string error; // 失败原因
+    int status = 0;
+    std::string head; // 状态行和头部，不含结尾空行
+    std::string body; // 已去掉 chunked 编码
+
+    // 忽略大小写查找头部，不存在时返回空
+    std::string_view header(std::string_view name) const;
+};
+
+// co_await 一次上游 HTTP 请求：在当前 IO 线程上用非阻塞套接字和 Channel 完成连接、发送和接收，
+// 结束后通过 EventLoop 恢复协程。每次请求新建一个连接，响应按 Content-Length 或 chunked 编码判断结束，
+// 两者都没有时才等对端关闭连接
+class HttpFetch
+{
+public:
+    // request 为完整的请求报文
+    HttpFetch(const InetAddress &server, std::string request, double timeoutSeconds);
+    ~HttpFetch();
+
+    HttpFetch(const HttpFetch &) = delete;
+    HttpFetch &operator=(const HttpFetch &) = delete;
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> handle);
+    UpstreamResponse await_resume() { return std::move(response_); }
+
+private:
+    static constexpr size_t kMaxTrailerBytes = 16 * 1024;
+
+    void onWritable();
+    void onReadable();
+    void onTimeout();
+    // 响应已完整时解析并返回 true
+    bool tryComplete(bool eof);
+    // 收到完整的头部时解析状态行和长度信息，头部移出 input_
+    bool parseHead();
+    void finish(std::string error);
+
+    InetAddress server_;
+    std::string request_;
+    double timeout_;
+
+    EventLoop *loop_ = nullptr;
+    int fd_ = -1;
+    std::unique_ptr<Channel> channel_;
+    TimerId timer_;
+    bool timerFired_ = false;
+    bool connected_ = false;
+    bool finished_ = false;
+    size_t written_ = 0;
+    std::string input_; // 解析头部之后只保存还没处理的响应体字节
+    bool headParsed_ = false;
+    bool chunked_ = false;
+    bool hasContentLength_ = false;
+    size_t contentLength_ = 0;
+    ChunkedDecoder chunkDecoder_;
+    UpstreamResponse response_;
+    std::coroutine_handle<> handle_;
+};
+
+// 构造一个 GET 请求
+inline HttpFetch httpGet(const InetAddress &server, std::string_view host, std::string_view path,
+                         double timeoutSeconds = 10.0)
+{
+    std::string request;
+    request.reserve(64 + host.size() + path.size());
+    request.append("GET ").append(path).append(" HTTP/1.1\r\nHost: ").append(host);
+    request.append("\r\nConnection: close\r\n\r\n");
+    return HttpFetch(server, std::move(request), timeoutSeconds);
+}
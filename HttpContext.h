@@ -0,0 +1,80 @@
+// HttpContext.h
+#pragma once
+
+#include "AccessLog.h"
+#include "Arena.h"
+#include "AsyncResponse.h"
+#include "BodyStream.h"
+#include "HttpRequestParser.h"
+#include "RateLimiter.h"
+#include "RequestContext.h"
+#include "StaticFile.h"
+#include "Task.h"
+#include "TimerWheel.h"
+
+#include <memory>
+
+class Buffer;
+
+// 每个 IO 线程独有的状态，由 HttpServer 在线程初始化回调中创建，只在该线程访问
+struct HttpLoopState
+{
+    TimerWheel wheel;
+    FileCache fileCache;
+    FramePool framePool; // 协程帧
+    Arena arena;         // 同步处理的请求的响应数据，每个请求处理完后 reset
+    RateLimiter rateLimiter; // 本线程的令牌桶，启用限流时分配
+
+    uint16_t threadIndex = 0;     // IO 线程序号，构成请求 ID 的高位
+    uint64_t requestSequence = 0; // 本线程已分配的请求数
+
+    uint64_t nextRequestId() { return RequestContext::makeId(threadIndex, ++requestSequence); }
+
+    AccessLog::Ring *accessRing = nullptr; // 启用访问日志时本线程的环形缓冲区
+};
+
+// 每个连接的 HTTP 状态，以 shared_ptr 形式保存在 TcpConnection 的 context 中，
+// 只在连接所属的 IO 线程访问
+struct HttpContext
+{
+    HttpRequestParser parser;
+
+    // 当前请求的 ID 和各阶段时间
+    RequestContext request;
+    Timestamp lastReceiveTime; // 最近一次可读事件的时间
+
+    std::string peer; // 对端地址，启用访问日志时在建立连接时格式化一次
+    uint64_t peerKey = 0; // 对端 IP 的哈希，启用限流时在建立连接时计算一次
+
+    // 空闲 / 读头部 / 读请求体超时共用一个定时节点，挂在所属 EventLoop 的时间轮上
+    TimerWheel::Node timer;
+    HttpLoopState *loopState = nullptr;
+    HttpRequestParser::Phase timerPhase = HttpRequestParser::kIdle; // 定时节点按哪个阶段设置
+    uint64_t timerRequestId = 0;                                    // 以及对应的请求
+
+    // 连接的输入缓冲区地址在连接生命周期内不变，记录下来以便在写完成回调中继续处理流水线请求
+    Buffer *input = nullptr;
+
+    // 正在发送的文件响应体，发送完之前不处理后续请求
+    FileBody fileBody;
+
+    // 有请求正在工作线程池中处理，响应发送之前不处理后续请求，保证流水线响应的顺序
+    bool asyncPending = false;
+
+    // 流式接收请求体的请求：请求头已拷贝出缓冲区，请求体边到达边交给 bodyStream。
+    // bodyPaused 表示 bodyStream 要求暂停接收，同时停止了读取
+    DetachedRequestPtr streamRequest;
+    BodyStreamPtr bodyStream;
+    bool streamKeepAlive = false;
+    bool bodyPaused = false;
+
+    // 输出超过高水位：等写完成回调之后再处理后续请求。
+    // readPaused 表示停止了读取：输出积压，或等待期间输入缓冲区超过一个最大请求
+    bool outputBlocked = false;
+    bool readPaused = false;
+
+    int requestCount = 0;  // 该连接上已处理的请求数
+    bool closing = false;  // 已决定关闭连接，不再处理后续请求
+};
+
+using HttpContextPtr = std::shared_ptr<HttpContext>;
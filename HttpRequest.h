@@ -1,9 +1,16 @@
 // HttpRequest.h
 #pragma once
 
+#include "HeaderMap.h"
+
+#include <array>
+#include <cstdint>
 #include <string>
-#include <map>
+#include <string_view>
+#include <utility>
 
+// 请求中的方法、路径、版本、头部和请求体都是指向连接 Buffer 的 string_view，
+// 只在该请求的字节被 retrieve 之前有效
 class HttpRequest
 {
 public:
@@ -17,35 +24,111 @@ public:
         kHead
     };
 
-    HttpRequest() : method_(kInvalid), version_("HTTP/1.1") {}
+    static constexpr int kMethodCount = kHead + 1;
+
+    // 路由最多捕获的路径参数个数
+    static constexpr size_t kMaxParams = 8;
+
+    using Header = std::pair<std::string_view, std::string_view>;
+    using Headers = HeaderMap;
+
+    HttpRequest() : method_(kInvalid), version_("HTTP/1.1"), paramCount_(0), requestId_(0) {}
 
     void setMethod(Method method) { method_ = method; }
     Method method() const { return method_; }
 
-    void setPath(const std::string &path) { path_ = path; }
-    const std::string &path() const { return path_; }
+    void setPath(std::string_view path) { path_ = path; }
+    std::string_view path() const { return path_; }
+
+    // '?' 之后的查询字符串，不含 '?'
+    void setQuery(std::string_view query) { query_ = query; }
+    std::string_view query() const { return query_; }
+
+    void setVersion(std::string_view version) { version_ = version; }
+    std::string_view version() const { return version_; }
+
+    void setBody(std::string_view body) { body_ = body; }
+    std::string_view body() const { return body_; }
+
+    // 服务器分配的请求 ID，用于日志关联
+    void setRequestId(uint64_t id) { requestId_ = id; }
+    uint64_t requestId() const { return requestId_; }
+
+    void addHeader(std::string_view key, std::string_view value)
+    {
+        headers_.add(key, value);
+    }
+
+    // 忽略大小写查找，同名头部返回第一个
+    std::string_view getHeader(std::string_view key) const
+    {
+        return headers_.get(key);
+    }
 
-    void setVersion(const std::string &version) { version_ = version; }
-    const std::string &version() const { return version_; }
+    std::string_view getHeader(HttpHeader::Known key) const
+    {
+        return headers_.get(key);
+    }
 
-    void setBody(const std::string &body) { body_ = body; }
-    const std::string &body() const { return body_; }
+    const Headers &headers() const { return headers_; }
 
-    void addHeader(const std::string &key, const std::string &value)
+    // 根据 Connection 头部和协议版本判断是否保持连接：
+    // HTTP/1.1 默认保持连接，HTTP/1.0 需要显式声明 Keep-Alive
+    bool keepAlive() const
     {
-        headers_[key] = value;
+        bool http10 = version_ == "HTTP/1.0";
+        if (!headers_.contains(HttpHeader::kConnection))
+        {
+            return !http10;
+        }
+        for (const auto &header : headers_)
+        {
+            if (header.known == HttpHeader::kConnection)
+            {
+                if (hasToken(header.value, "close"))
+                {
+                    return false;
+                }
+                if (hasToken(header.value, "keep-alive"))
+                {
+                    return true;
+                }
+            }
+        }
+        return !http10;
     }
 
-    std::string getHeader(const std::string &key) const
+    static bool equalsIgnoreCase(std::string_view a, std::string_view b)
     {
-        auto it = headers_.find(key);
-        return it != headers_.end() ? it->second : "";
+        return HttpHeader::equalsIgnoreCase(a, b);
     }
 
-    const std::map<std::string, std::string> &headers() const { return headers_; }
+    // 判断逗号分隔的列表中是否包含 token（忽略大小写）
+    static bool hasToken(std::string_view list, std::string_view token)
+    {
+        while (!list.empty())
+        {
+            size_t comma = list.find(',');
+            std::string_view item = list.substr(0, comma);
+            while (!item.empty() && (item.front() == ' ' || item.front() == '\t'))
+                item.remove_prefix(1);
+            while (!item.empty() && (item.back() == ' ' || item.back() == '\t'))
+                item.remove_suffix(1);
+            if (equalsIgnoreCase(item, token))
+            {
+                return true;
+            }
+            if (comma == std::string_view::npos)
+            {
+                break;
+            }
+            list.remove_prefix(comma + 1);
+        }
+        return false;
+    }
 
     // 将方法字符串转换为Method枚举
-    static Method stringToMethod(const std::string &methodStr)
+    static Method stringToMethod(std::string_view methodStr)
     {
         if (methodStr == "GET")
             return kGet;
@@ -80,37 +163,86 @@ public:
         }
     }
 
+    // 只清空视图，headers_ 保留容量供下一个请求复用
     void reset()
     {
         method_ = kInvalid;
-        path_ = "";
+        path_ = std::string_view();
+        query_ = std::string_view();
         version_ = "HTTP/1.1";
-        body_ = "你好";
+        body_ = std::string_view();
         headers_.clear();
+        paramCount_ = 0;
+        requestId_ = 0;
     }
-    std::string getPath() const 
-{
-    return path_;
-}
-// 定义一个常量成员函数
-std::string getParam(const std::string &paramName) const
-{
-    std::string path = getPath(); // 获取路径
-    size_t pos = path.find(paramName);
-    if (pos != std::string::npos)
+
+    std::string getPath() const
+    {
+        return std::string(path_);
+    }
+
+    // 路由捕获的路径参数：名字属于路由表，值指向请求路径
+    bool addParam(std::string_view name, std::string_view value)
+    {
+        if (paramCount_ == kMaxParams)
+        {
+            return false;
+        }
+        params_[paramCount_++] = Header(name, value);
+        return true;
+    }
+
+    std::string_view getParam(std::string_view name) const
+    {
+        for (size_t i = 0; i < paramCount_; ++i)
+        {
+            if (params_[i].first == name)
+            {
+                return params_[i].second;
+            }
+        }
+        return std::string_view();
+    }
+
+    size_t paramCount() const { return paramCount_; }
+
+    // 路由匹配失败回溯时丢弃多余的参数
+    void truncateParams(size_t count) { paramCount_ = count; }
+
+    // 请求的原始字节从 [from, from + len) 拷贝到 to 之后，把指向原字节的视图移到副本上。
+    // 不在该范围内的视图（默认版本号、路由表中的参数名）保持不变
+    void rebase(const char *from, size_t len, const char *to)
     {
-        // 假设 URL 格式为 "/user/123"
-        size_t start = path.find_last_of('/') + 1;
-        return path.substr(start); // 提取并返回参数部分
+        auto move = [from, len, to](std::string_view &view)
+        {
+            if (view.data() >= from && view.data() + view.size() <= from + len && !view.empty())
+            {
+                view = std::string_view(to + (view.data() - from), view.size());
+            }
+        };
+        move(path_);
+        move(query_);
+        move(version_);
+        move(body_);
+        for (auto &header : headers_)
+        {
+            move(header.name);
+            move(header.value);
+        }
+        for (size_t i = 0; i < paramCount_; ++i)
+        {
+            move(params_[i].second);
+        }
     }
-    return ""; // 如果没有找到，返回空字符串
-}
 
 private:
     Method method_;
-    std::string path_;
-    std::string version_;
-    std::string body_;
-    std::map<std::string, std::string> headers_;
+    std::string_view path_;
+    std::string_view query_;
+    std::string_view version_;
+    std::string_view body_;
+    Headers headers_;
+    std::array<Header, kMaxParams> params_;
+    size_t paramCount_;
+    uint64_t requestId_;
 };
-
@@ -1,111 +1,333 @@
 // HttpRequestParser.h
 #pragma once
 
+#include "ChunkedDecoder.h"
 #include "HttpRequest.h"
+#include "HttpTokenizer.h"
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
 #include <string>
+#include <string_view>
+#include <vector>
 
+// 可续传的增量解析器：
+// parse 每次都以当前请求的第一个字节为 begin 调用，解析器记住已经扫描到的偏移，
+// 只处理新到达的字节。Buffer 在两次调用之间可能扩容或搬移数据，
+// 所以解析过程中只保存相对 begin 的偏移量，解析完成时才生成指向 Buffer 的 string_view。
+// 请求行、头部和请求体的大小都有上限，超过时不等请求接收完就返回错误，连接缓冲区不会无限增长。
+// 请求体可以是 Content-Length 或 chunked 编码；chunked 请求体边扫描边解码到解析器自己的缓冲区。
+// 设置 stopAtBody 后，parse 在头部结束时先返回 kHeadersComplete，调用方可以改用 parseBody 流式接收请求体
 class HttpRequestParser
 {
 public:
     enum HttpRequestParseResult
     {
-        kOk,         // 解析成功
-        kBadRequest, // 请求格式错误
-        kNotComplete // 请求不完整
+        kOk,             // 解析成功
+        kBadRequest,     // 请求格式错误
+        kNotComplete,    // 请求不完整
+        kUriTooLong,     // 请求行超过上限，回复 414
+        kHeaderTooLarge, // 头部个数或总字节数超过上限，回复 431
+        kBodyTooLarge,   // 请求体超过上限，回复 413
+        kHeadersComplete // 设置了 stopAtBody 时，带请求体的请求在头部结束后返回一次
     };
 
-    HttpRequestParser() : state_(kRequestLine) {}
+    struct Limits
+    {
+        size_t maxRequestLine = 8 * 1024;     // 请求行（含之前的空行）的字节数
+        size_t maxHeaderBytes = 16 * 1024;    // 全部头部行的字节数
+        size_t maxHeaderCount = 100;          // 头部个数
+        size_t maxBodySize = 8 * 1024 * 1024; // 请求体字节数
+
+        // 流式接收的请求体不在内存中缓存，上限单独设置，0 表示不限制
+        size_t maxStreamBodySize = size_t(1) << 30;
+
+        // 一个请求最多占用的输入缓冲区大小
+        size_t maxRequestSize() const { return maxRequestLine + maxHeaderBytes + maxBodySize; }
+    };
+
+    // 当前请求所处的阶段，供连接的超时管理使用
+    enum Phase
+    {
+        kIdle,           // 还没有收到新请求的任何字节
+        kReadingHeaders, // 正在接收请求行和头部
+        kReadingBody     // 正在接收请求体
+    };
+
+    HttpRequestParser()
+        : state_(kRequestLine),
+          checked_(0),
+          lineStart_(0),
+          bodyStart_(0),
+          headersStart_(0),
+          contentLength_(0),
+          hasContentLength_(false),
+          hasTransferEncoding_(false),
+          chunked_(false),
+          stopAtBody_(false),
+          headBuilt_(false),
+          headBase_(nullptr),
+          bodyRemaining_(0),
+          pathSpan_{0, 0},
+          versionSpan_{0, 0},
+          limits_(&defaultLimits())
+    {
+    }
+
+    // limits 由调用方持有，在解析器的生命周期内有效
+    void setLimits(const Limits *limits) { limits_ = limits; }
+    const Limits &limits() const { return *limits_; }
+
+    static const Limits &defaultLimits()
+    {
+        static const Limits limits;
+        return limits;
+    }
+
+    // 带请求体的请求在头部结束时先返回 kHeadersComplete，此时 request() 中只有请求头。
+    // 调用方再次调用 parse 继续缓存请求体，或者调用 streamBody 改为流式接收
+    void setStopAtBody(bool stop) { stopAtBody_ = stop; }
 
     HttpRequestParseResult parse(const char *begin, const char *end)
     {
-        const char *start = begin;
-        const char *lineEnd;
+        const size_t len = static_cast<size_t>(end - begin);
 
-        while (start < end)
+        while (state_ != kDone)
         {
-            if (state_ == kRequestLine)
+            if (state_ == kBody)
             {
-                lineEnd = std::find(start, end, '\n');
-                if (lineEnd == end)
+                // 头部阶段按流式上限放行的请求体，缓存时仍然受 maxBodySize 限制
+                if (contentLength_ > limits_->maxBodySize)
                 {
-                    return kNotComplete;
+                    return kBodyTooLarge;
                 }
-
-                if (!parseRequestLine(start, lineEnd))
+                if (!chunked_)
                 {
-                    return kBadRequest;
+                    // 请求体不扫描，只需要等够 Content-Length 字节
+                    if (len - bodyStart_ < contentLength_)
+                    {
+                        return kNotComplete;
+                    }
+                    checked_ = bodyStart_ + contentLength_;
+                    state_ = kDone;
+                    break;
                 }
 
-                start = lineEnd + 1;
-                state_ = kHeaders;
+                // chunked 请求体解码到 chunkedBody_，原始字节留在缓冲区中直到请求处理完
+                size_t consumed = 0;
+                HttpRequestParseResult result = parseBody(begin + checked_, end, &consumed,
+                                                          [this](const char *data, size_t n)
+                                                          {
+                                                              chunkedBody_.append(data, n);
+                                                              return true;
+                                                          });
+                checked_ += consumed;
+                if (result != kOk)
+                {
+                    return result;
+                }
+                state_ = kDone;
+                break;
             }
-            else if (state_ == kHeaders)
+
+            // 从上次停下的位置继续查找行尾
+            const char *lineEnd = static_cast<const char *>(
+                std::memchr(begin + checked_, '\n', len - checked_));
+            if (lineEnd == nullptr)
             {
-                lineEnd = std::find(start, end, '\n');
-                if (lineEnd == end)
+                checked_ = len;
+                // 还没有收到行尾，但已经超过上限的行不必再等
+                if (state_ == kRequestLine && len > limits_->maxRequestLine)
+                {
+                    return kUriTooLong;
+                }
+                if (state_ == kHeaders && len - headersStart_ > limits_->maxHeaderBytes)
                 {
-                    return kNotComplete;
+                    return kHeaderTooLarge;
                 }
+                return kNotComplete;
+            }
+
+            size_t next = static_cast<size_t>(lineEnd - begin) + 1;
+            size_t contentEnd = next - 1;
+            if (contentEnd > lineStart_ && begin[contentEnd - 1] == '\r')
+            {
+                --contentEnd;
+            }
+            checked_ = next;
 
-                if (!parseHeader(start, lineEnd))
+            if (state_ == kRequestLine)
+            {
+                if (contentEnd > limits_->maxRequestLine)
+                {
+                    return kUriTooLong;
+                }
+                // 忽略请求行之前多余的空行
+                if (contentEnd != lineStart_)
                 {
-                    // 空行，表示头部结束
-                    if (start == lineEnd - 1 && *start == '\r')
+                    if (!parseRequestLine(begin, lineStart_, contentEnd))
                     {
-                        start = lineEnd + 1;
-
-                        // 检查Content-Length头部
-                        std::string contentLengthStr = request_.getHeader("Content-Length");
-                        if (!contentLengthStr.empty())
-                        {
-                            contentLength_ = std::stoi(contentLengthStr);
-                            state_ = kBody;
-                        }
-                        else
-                        {
-                            // 没有请求体，解析完成
-                            return kOk;
-                        }
+                        return kBadRequest;
                     }
-                    else
+                    state_ = kHeaders;
+                    headersStart_ = checked_;
+                }
+            }
+            else if (checked_ - headersStart_ > limits_->maxHeaderBytes)
+            {
+                return kHeaderTooLarge;
+            }
+            else if (contentEnd == lineStart_)
+            {
+                // 空行，表示头部结束。同时带有 Content-Length 和 Transfer-Encoding 的请求
+                // 两端可能对请求边界理解不一致（请求走私），直接拒绝；
+                // chunked 以外的传输编码无法确定请求体在哪里结束，同样拒绝
+                if ((hasContentLength_ && hasTransferEncoding_) || (hasTransferEncoding_ && !chunked_))
+                {
+                    return kBadRequest;
+                }
+                bodyStart_ = checked_;
+                if (chunked_)
+                {
+                    chunkDecoder_.reset(limits_->maxBodySize, limits_->maxHeaderBytes);
+                }
+                else
+                {
+                    bodyRemaining_ = contentLength_;
+                }
+
+                if (chunked_ || contentLength_ > 0)
+                {
+                    state_ = kBody;
+                    if (stopAtBody_)
                     {
-                        // 头部格式错误
-                        return kBadRequest;
+                        lineStart_ = checked_;
+                        buildHead(begin);
+                        return kHeadersComplete;
                     }
                 }
                 else
                 {
-                    // 继续解析下一个头部
-                    start = lineEnd + 1;
+                    state_ = kDone;
                 }
             }
-            else if (state_ == kBody)
+            else if (headerSpans_.size() >= limits_->maxHeaderCount)
             {
-                // 解析请求体
-                if (end - start < contentLength_)
-                {
-                    // 请求体不完整
-                    return kNotComplete;
-                }
+                return kHeaderTooLarge;
+            }
+            else if (!parseHeader(begin, lineStart_, contentEnd))
+            {
+                // 头部格式错误
+                return kBadRequest;
+            }
+            else if (contentLength_ > headerBodyLimit())
+            {
+                // 不等请求体到达就拒绝
+                return kBodyTooLarge;
+            }
 
-                request_.setBody(std::string(start, start + contentLength_));
+            lineStart_ = checked_;
+        }
+
+        buildRequest(begin);
+        return kOk;
+    }
+
+    // 当前请求占用的字节数，parse 返回 kOk 之后有效，调用方据此 retrieve。
+    // 返回 kHeadersComplete 之后为请求头占用的字节数
+    size_t consumed() const { return checked_; }
 
-                // 解析完成
+    // parse 返回 kHeadersComplete 之后调用：请求体改为由 parseBody 流式接收，上限为 maxStreamBodySize。
+    // 调用方随即 retrieve 掉 consumed() 字节的请求头，request() 中的视图随之失效，需要先拷贝。
+    // Content-Length 超过上限时返回 false
+    bool streamBody()
+    {
+        size_t limit = limits_->maxStreamBodySize > 0 ? limits_->maxStreamBodySize : SIZE_MAX;
+        chunkDecoder_.setBodyLimit(limit);
+        return chunked_ || contentLength_ <= limit;
+    }
+
+    // 接收请求体：[begin, end) 从第一个还没处理的请求体字节开始，其中的数据段（已去掉 chunked 编码）
+    // 依次交给 sink(const char *data, size_t n)，sink 返回 false 时在该段之后停止。
+    // *consumed 为处理掉的字节数，返回 kOk 表示请求体已经结束，kNotComplete 表示需要更多数据
+    template <typename Sink>
+    HttpRequestParseResult parseBody(const char *begin, const char *end, size_t *consumed, Sink &&sink)
+    {
+        if (chunked_)
+        {
+            switch (chunkDecoder_.decode(begin, end, consumed, sink))
+            {
+            case ChunkedDecoder::kOk:
                 return kOk;
+            case ChunkedDecoder::kNotComplete:
+                return kNotComplete;
+            case ChunkedDecoder::kBodyTooLarge:
+                return kBodyTooLarge;
+            case ChunkedDecoder::kTrailerTooLarge:
+                return kHeaderTooLarge;
+            default:
+                return kBadRequest;
             }
         }
 
-        // 请求不完整
-        return kNotComplete;
+        const char *p = begin;
+        while (bodyRemaining_ > 0 && p != end)
+        {
+            size_t n = std::min(bodyRemaining_, static_cast<size_t>(end - p));
+            const char *data = p;
+            p += n;
+            bodyRemaining_ -= n;
+            if (!sink(data, n))
+            {
+                break;
+            }
+        }
+        *consumed = static_cast<size_t>(p - begin);
+        return bodyRemaining_ == 0 ? kOk : kNotComplete;
     }
 
     const HttpRequest &request() const { return request_; }
+    HttpRequest &request() { return request_; }
+
+    Phase phase() const
+    {
+        if (state_ == kBody)
+        {
+            return kReadingBody;
+        }
+        if (state_ == kRequestLine && checked_ == 0)
+        {
+            return kIdle;
+        }
+        return kReadingHeaders;
+    }
 
     void reset()
     {
         request_.reset();
         state_ = kRequestLine;
+        checked_ = 0;
+        lineStart_ = 0;
+        bodyStart_ = 0;
+        headersStart_ = 0;
         contentLength_ = 0;
+        hasContentLength_ = false;
+        hasTransferEncoding_ = false;
+        chunked_ = false;
+        headBuilt_ = false;
+        headBase_ = nullptr;
+        bodyRemaining_ = 0;
+        headerSpans_.clear();
+        // 保留小的解码缓冲区供下一个请求复用，大的释放掉
+        if (chunkedBody_.capacity() > kKeepChunkedCapacity)
+        {
+            std::string().swap(chunkedBody_);
+        }
+        else
+        {
+            chunkedBody_.clear();
+        }
     }
 
 private:
@@ -113,96 +335,190 @@ private:
     {
         kRequestLine,
         kHeaders,
-        kBody
+        kBody,
+        kDone
+    };
+
+    static constexpr size_t kKeepChunkedCapacity = 64 * 1024;
+
+    // 相对请求起始位置的偏移区间
+    struct Span
+    {
+        size_t offset;
+        size_t length;
     };
 
     HttpRequest request_;
     ParseState state_;
-    int contentLength_;
+    size_t checked_;   // 已扫描的字节数
+    size_t lineStart_; // 当前行的起始偏移
+    size_t bodyStart_;
+    size_t headersStart_; // 第一个头部行的偏移
+    size_t contentLength_;
+    bool hasContentLength_;
+    bool hasTransferEncoding_;
+    bool chunked_; // Transfer-Encoding: chunked
+    bool stopAtBody_;
+    bool headBuilt_;        // 已在 kHeadersComplete 时生成请求头的视图
+    const char *headBase_;  // 生成视图时的 begin
+    size_t bodyRemaining_;        // Content-Length 请求体剩余的字节数
+    ChunkedDecoder chunkDecoder_; // chunked 请求体的解码状态，缓存和流式接收共用
+    std::string chunkedBody_; // 缓存模式下解码后的 chunked 请求体
+    Span pathSpan_;
+    Span versionSpan_;
+    std::vector<std::pair<Span, Span>> headerSpans_;
+    const Limits *limits_;
+
+    static std::string_view view(const char *base, Span span)
+    {
+        return std::string_view(base + span.offset, span.length);
+    }
 
-    bool parseRequestLine(const char *begin, const char *end)
+    // 头部阶段还不知道请求体会不会流式接收，按两个上限中较大的一个检查
+    size_t headerBodyLimit() const
     {
-        const char *space = std::find(begin, end, ' ');
-        if (space == end)
+        if (!stopAtBody_)
         {
-            return false;
+            return limits_->maxBodySize;
         }
+        size_t streamLimit = limits_->maxStreamBodySize > 0 ? limits_->maxStreamBodySize : SIZE_MAX;
+        return std::max(limits_->maxBodySize, streamLimit);
+    }
 
-        // 解析方法
-        std::string methodStr(begin, space);
-        HttpRequest::Method method = HttpRequest::stringToMethod(methodStr);
-        if (method == HttpRequest::kInvalid)
+    void buildRequest(const char *begin)
+    {
+        if (!headBuilt_)
         {
-            return false;
+            buildHead(begin);
         }
-        request_.setMethod(method);
+        else if (headBase_ != begin)
+        {
+            // 返回 kHeadersComplete 之后缓冲区可能扩容搬移过
+            request_.rebase(headBase_, bodyStart_, begin);
+        }
+        if (chunked_)
+        {
+            request_.setBody(chunkedBody_);
+        }
+        else
+        {
+            request_.setBody(std::string_view(begin + bodyStart_, contentLength_));
+        }
+    }
 
-        // 解析路径
-        begin = space + 1;
-        space = std::find(begin, end, ' ');
-        if (space == end)
+    void buildHead(const char *begin)
+    {
+        headBuilt_ = true;
+        headBase_ = begin;
+        std::string_view target = view(begin, pathSpan_);
+        size_t question = target.find('?');
+        request_.setPath(target.substr(0, question));
+        if (question != std::string_view::npos)
         {
-            return false;
+            request_.setQuery(target.substr(question + 1));
+        }
+        request_.setVersion(view(begin, versionSpan_));
+        for (const auto &header : headerSpans_)
+        {
+            request_.addHeader(view(begin, header.first), view(begin, header.second));
         }
+    }
 
-        request_.setPath(std::string(begin, space));
+    // 请求行："方法 SP 请求目标 SP HTTP/x.y"，方法和请求目标同时校验字符
+    bool parseRequestLine(const char *base, size_t begin, size_t end)
+    {
+        const char *line = base + begin;
+        const char *lineEnd = base + end;
 
-        // 解析版本
-        begin = space + 1;
-        std::string version(begin, end);
-        if (version.length() >= 2 && version[version.length() - 2] == '\r')
+        // 解析方法
+        const char *methodEnd = HttpTokenizer::skipToken(line, lineEnd);
+        if (methodEnd == line || methodEnd == lineEnd || *methodEnd != ' ')
         {
-            version = version.substr(0, version.length() - 2);
+            return false;
         }
-        else if (version.length() >= 1 && version[version.length() - 1] == '\n')
+        HttpRequest::Method method = HttpRequest::stringToMethod(std::string_view(line, methodEnd - line));
+        if (method == HttpRequest::kInvalid)
         {
-            version = version.substr(0, version.length() - 1);
+            return false;
         }
+        request_.setMethod(method);
 
-        if (version.empty() || version.substr(0, 5) != "HTTP/")
+        // 解析路径
+        const char *target = methodEnd + 1;
+        const char *targetEnd = HttpTokenizer::skipTarget(target, lineEnd);
+        if (targetEnd == target || targetEnd == lineEnd || *targetEnd != ' ')
         {
             return false;
         }
+        pathSpan_ = Span{static_cast<size_t>(target - base), static_cast<size_t>(targetEnd - target)};
 
-        request_.setVersion(version);
+        // 解析版本
+        std::string_view version(targetEnd + 1, lineEnd - targetEnd - 1);
+        if (version.size() <= 5 || version.substr(0, 5) != "HTTP/")
+        {
+            return false;
+        }
+        versionSpan_ = Span{static_cast<size_t>(targetEnd + 1 - base), version.size()};
 
         return true;
     }
 
-    bool parseHeader(const char *begin, const char *end)
+    // 头部行："名字: 值"，名字必须是 token 且紧跟冒号，值中不能有除制表符以外的控制字符
+    bool parseHeader(const char *base, size_t begin, size_t end)
     {
-        // 检查是否为空行
-        if (begin == end - 1 && *begin == '\r')
+        const char *line = base + begin;
+        const char *lineEnd = base + end;
+
+        const char *nameEnd = HttpTokenizer::skipToken(line, lineEnd);
+        if (nameEnd == line || nameEnd == lineEnd || *nameEnd != ':')
         {
             return false;
         }
 
-        const char *colon = std::find(begin, end, ':');
-        if (colon == end)
+        // 跳过值两侧的空白
+        const char *valueStart = nameEnd + 1;
+        while (valueStart != lineEnd && (*valueStart == ' ' || *valueStart == '\t'))
+        {
+            ++valueStart;
+        }
+        if (HttpTokenizer::skipFieldValue(valueStart, lineEnd) != lineEnd)
         {
             return false;
         }
-
-        std::string key(begin, colon);
-        ++colon;
-
-        // 跳过空格
-        while (colon < end && isspace(*colon))
+        const char *valueEnd = lineEnd;
+        while (valueEnd != valueStart && (valueEnd[-1] == ' ' || valueEnd[-1] == '\t'))
         {
-            ++colon;
+            --valueEnd;
         }
 
-        std::string value(colon, end);
-        if (value.length() >= 2 && value[value.length() - 2] == '\r')
+        std::string_view key(line, nameEnd - line);
+        std::string_view value(valueStart, valueEnd - valueStart);
+
+        // 解析过程中就需要知道 Content-Length 才能决定是否进入 kBody。
+        // 只接受十进制数字，溢出、空值和多个不一致的值都视为格式错误
+        HttpHeader::Known known = HttpHeader::classify(key);
+        if (known == HttpHeader::kContentLength)
         {
-            value = value.substr(0, value.length() - 2);
+            size_t length = 0;
+            auto result = std::from_chars(value.data(), value.data() + value.size(), length);
+            if (value.empty() || result.ec != std::errc() || result.ptr != value.data() + value.size() ||
+                (hasContentLength_ && length != contentLength_))
+            {
+                return false;
+            }
+            contentLength_ = length;
+            hasContentLength_ = true;
         }
-        else if (value.length() >= 1 && value[value.length() - 1] == '\n')
+        else if (known == HttpHeader::kTransferEncoding)
         {
-            value = value.substr(0, value.length() - 1);
+            // 只支持单独的 chunked：其他编码无法解码，也就无法确定请求体在哪里结束。
+            // 出现多个 Transfer-Encoding 头部时同样拒绝
+            chunked_ = !hasTransferEncoding_ && HttpRequest::equalsIgnoreCase(value, "chunked");
+            hasTransferEncoding_ = true;
         }
 
-        request_.addHeader(key, value);
+        headerSpans_.push_back({Span{begin, key.size()},
+                                Span{static_cast<size_t>(valueStart - base), value.size()}});
 
         return true;
     }
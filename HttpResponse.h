@@ -1,10 +1,21 @@
 // HttpResponse.h
 #pragma once
 
+#include "Arena.h"
+#include "HeaderMap.h"
+
+#include <charconv>
+#include <cstring>
+#include <ctime>
+#include <initializer_list>
+#include <memory>
 #include <string>
-#include <map>
-#include <sstream>
+#include <string_view>
+#include <utility>
 
+// 响应头部的名字和值，以及不超过 kArenaBodyMax 的响应体拷贝到 Arena 中保存。服务器在 IO 线程上
+// 同步处理请求时传入本线程的 Arena，响应序列化之后整体回收；没有传入时响应第一次需要时自己创建一个，
+// 随响应一起释放
 class HttpResponse
 {
 public:
@@ -12,97 +23,315 @@ public:
     {
         k200Ok = 200,
         k201Created=201,
+        k206PartialContent = 206,
         k301MovedPermanently = 301,
         k302Found = 302,
+        k304NotModified = 304,
         k400BadRequest = 400,
         k401Unauthorized = 401,
         k403Forbidden = 403,
         k404NotFound = 404,
-        k500InternalServerError = 500
+        k413PayloadTooLarge = 413,
+        k414UriTooLong = 414,
+        k416RangeNotSatisfiable = 416,
+        k429TooManyRequests = 429,
+        k431RequestHeaderFieldsTooLarge = 431,
+        k500InternalServerError = 500,
+        k503ServiceUnavailable = 503
     };
 
-    HttpResponse() : statusCode_(k200Ok), version_("HTTP/1.1") {}
+    explicit HttpResponse(Arena *arena = nullptr)
+        : statusCode_(k200Ok),
+          version_(kDefaultVersion),
+          bodyStorage_(kOwnedBody),
+          suppressBody_(false),
+          arena_(arena)
+    {
+    }
+
+    // 拷贝时头部重新存放到新响应自己的 Arena 中
+    HttpResponse(const HttpResponse &other) : HttpResponse() { *this = other; }
+
+    HttpResponse &operator=(const HttpResponse &other)
+    {
+        if (this != &other)
+        {
+            statusCode_ = other.statusCode_;
+            setVersion(other.version_);
+            ownedBody_ = other.ownedBody_;
+            bodyView_ = other.bodyStorage_ == kArenaBody ? arena()->copy(other.bodyView_) : other.bodyView_;
+            bodyStorage_ = other.bodyStorage_;
+            suppressBody_ = other.suppressBody_;
+            headers_.clear();
+            for (const auto &header : other.headers_)
+            {
+                addHeader(header.name, header.value);
+            }
+        }
+        return *this;
+    }
+
+    HttpResponse(HttpResponse &&) = default;
+    HttpResponse &operator=(HttpResponse &&) = default;
 
     void setStatusCode(HttpStatusCode code) { statusCode_ = code; }
     HttpStatusCode statusCode() const { return statusCode_; }
 
-    void setVersion(const std::string &version) { version_ = version; }
-    const std::string &version() const { return version_; }
+    void setVersion(std::string_view version)
+    {
+        version_ = version == kDefaultVersion ? kDefaultVersion : arena()->copy(version);
+    }
+    std::string_view version() const { return version_; }
 
-    void setBody(const std::string &body)
-    { 
-        body_ = body;
-        std::cout << "Response body: " << body << std::endl;
+    // 拷贝响应体：不超过 kArenaBodyMax 时拷贝到 arena() 中，不单独 malloc/free；
+    // 更大的响应体放在堆上，避免偶尔的大响应把 Arena 保留的容量撑大
+    void setBody(std::string_view body)
+    {
+        if (body.size() <= kArenaBodyMax)
+        {
+            bodyView_ = arena()->copy(body);
+            bodyStorage_ = kArenaBody;
+        }
+        else
+        {
+            ownedBody_.assign(body.data(), body.size());
+            bodyStorage_ = kOwnedBody;
+        }
     }
-    const std::string &body() const { return body_; }
 
-    void addHeader(const std::string &key, const std::string &value)
+    void setBody(const char *body) { setBody(std::string_view(body)); }
+
+    // 按顺序拼接各段作为响应体，不需要先拼成临时 std::string，如 setBody({"You sent: ", req.body()})
+    void setBody(std::initializer_list<std::string_view> parts)
     {
-        headers_[key] = value;
+        size_t size = 0;
+        for (std::string_view part : parts)
+        {
+            size += part.size();
+        }
+        char *data;
+        if (size <= kArenaBodyMax)
+        {
+            data = static_cast<char *>(arena()->allocate(size > 0 ? size : 1, 1));
+            bodyView_ = std::string_view(data, size);
+            bodyStorage_ = kArenaBody;
+        }
+        else
+        {
+            ownedBody_.resize(size);
+            data = ownedBody_.data();
+            bodyStorage_ = kOwnedBody;
+        }
+        for (std::string_view part : parts)
+        {
+            std::memcpy(data, part.data(), part.size());
+            data += part.size();
+        }
     }
 
-    void setContentType(const std::string &contentType)
+    // 已经构造好的 std::string 直接移交，不再拷贝
+    void setBody(std::string &&body)
     {
-        addHeader("Content-Type", contentType);
+        ownedBody_ = std::move(body);
+        bodyStorage_ = kOwnedBody;
     }
 
-    std::string toString() const
+    // 借用外部数据作为响应体，调用方保证其在响应序列化之前一直有效（如字符串字面量）
+    void setBodyView(std::string_view body)
     {
-        std::ostringstream oss;
+        ownedBody_.clear();
+        bodyView_ = body;
+        bodyStorage_ = kBorrowedBody;
+    }
 
-        // 状态行
-        oss << version_ << " " << statusCode_ << " " << statusCodeToString(statusCode_) << "\r\n";
+    std::string_view body() const
+    {
+        return bodyStorage_ == kOwnedBody ? std::string_view(ownedBody_) : bodyView_;
+    }
 
-        // 响应头
-        for (const auto &header : headers_)
+    // 头部使用的 Arena，处理函数也可以在其中分配只需要存活到响应发送为止的临时数据
+    Arena *arena()
+    {
+        if (arena_ != nullptr)
         {
-            oss << header.first << ": " << header.second << "\r\n";
+            return arena_;
         }
+        if (!ownArena_)
+        {
+            ownArena_ = std::make_unique<Arena>(kOwnArenaSize);
+        }
+        return ownArena_.get();
+    }
+
+    // HEAD 请求的响应只发送头部，Content-Length 仍按响应体计算
+    void setSuppressBody(bool suppress) { suppressBody_ = suppress; }
+
+    // 同名头部（忽略大小写）只保留最后一次设置的值
+    void addHeader(std::string_view key, std::string_view value)
+    {
+        Arena *arena = this->arena();
+        headers_.set(arena->copy(key), arena->copy(value));
+    }
+
+    std::string_view getHeader(std::string_view key) const { return headers_.get(key); }
+    std::string_view getHeader(HttpHeader::Known key) const { return headers_.get(key); }
 
-        // 如果没有Content-Length头，添加一个
-        if (headers_.find("Content-Length") == headers_.end())
+    void setContentType(std::string_view contentType)
+    {
+        addHeader("Content-Type", contentType);
+    }
+
+    // 直接把响应写到输出缓冲区末尾，不产生中间字符串
+    void appendToBuffer(std::string *output) const
+    {
+        appendHeaderLines(output);
+
+        if (!headers_.contains(HttpHeader::kDate))
         {
-            oss << "Content-Length: " << body_.size() << "\r\n";
+            std::string_view date = dateHeader();
+            output->append(date.data(), date.size());
         }
 
         // 空行
-        oss << "\r\n";
+        output->append("\r\n", 2);
 
         // 响应体
-        oss << body_;
+        if (!suppressBody_)
+        {
+            std::string_view body = this->body();
+            output->append(body.data(), body.size());
+        }
+    }
+
+    // 写出状态行、响应头和 Content-Length，不含 Date 和结束头部的空行
+    void appendHeaderLines(std::string *output) const
+    {
+        // 状态行
+        std::string_view line = statusLine(statusCode_);
+        if (version_ != "HTTP/1.1")
+        {
+            output->append(version_);
+            line.remove_prefix(8);
+        }
+        output->append(line.data(), line.size());
+
+        // 响应头
+        for (const auto &header : headers_)
+        {
+            output->append(header.name);
+            output->append(": ", 2);
+            output->append(header.value);
+            output->append("\r\n", 2);
+        }
+
+        // 如果没有Content-Length头，添加一个（304 没有响应体，chunked 响应不需要）
+        if (!headers_.contains(HttpHeader::kContentLength) && !headers_.contains(HttpHeader::kTransferEncoding) &&
+            statusCode_ != k304NotModified)
+        {
+            char digits[24];
+            auto result = std::to_chars(digits, digits + sizeof digits, body().size());
+            output->append("Content-Length: ", 16);
+            output->append(digits, result.ptr - digits);
+            output->append("\r\n", 2);
+        }
+    }
 
-        return oss.str();
+    std::string toString() const
+    {
+        std::string result;
+        appendToBuffer(&result);
+        return result;
     }
 
-    // 将状态码转换为状态短语
-    static std::string statusCodeToString(HttpStatusCode code)
+    // 预先格式化好的状态行，以 "\r\n" 结尾
+    static constexpr std::string_view statusLine(HttpStatusCode code)
     {
         switch (code)
         {
         case k200Ok:
-            return "OK";
+            return "HTTP/1.1 200 OK\r\n";
+        case k201Created:
+            return "HTTP/1.1 201 Created\r\n";
+        case k206PartialContent:
+            return "HTTP/1.1 206 Partial Content\r\n";
         case k301MovedPermanently:
-            return "Moved Permanently";
+            return "HTTP/1.1 301 Moved Permanently\r\n";
         case k302Found:
-            return "Found";
+            return "HTTP/1.1 302 Found\r\n";
+        case k304NotModified:
+            return "HTTP/1.1 304 Not Modified\r\n";
         case k400BadRequest:
-            return "Bad Request";
+            return "HTTP/1.1 400 Bad Request\r\n";
         case k401Unauthorized:
-            return "Unauthorized";
+            return "HTTP/1.1 401 Unauthorized\r\n";
         case k403Forbidden:
-            return "Forbidden";
+            return "HTTP/1.1 403 Forbidden\r\n";
         case k404NotFound:
-            return "Not Found";
+            return "HTTP/1.1 404 Not Found\r\n";
+        case k413PayloadTooLarge:
+            return "HTTP/1.1 413 Payload Too Large\r\n";
+        case k414UriTooLong:
+            return "HTTP/1.1 414 URI Too Long\r\n";
+        case k416RangeNotSatisfiable:
+            return "HTTP/1.1 416 Range Not Satisfiable\r\n";
+        case k429TooManyRequests:
+            return "HTTP/1.1 429 Too Many Requests\r\n";
+        case k431RequestHeaderFieldsTooLarge:
+            return "HTTP/1.1 431 Request Header Fields Too Large\r\n";
         case k500InternalServerError:
-            return "Internal Server Error";
+            return "HTTP/1.1 500 Internal Server Error\r\n";
+        case k503ServiceUnavailable:
+            return "HTTP/1.1 503 Service Unavailable\r\n";
         default:
-            return "Unknown";
+            return "HTTP/1.1 500 Internal Server Error\r\n";
         }
     }
 
+    // 将状态码转换为状态短语
+    static std::string statusCodeToString(HttpStatusCode code)
+    {
+        // 去掉 "HTTP/1.1 xxx " 和结尾的 "\r\n"
+        std::string_view line = statusLine(code);
+        return std::string(line.substr(13, line.size() - 15));
+    }
+
+    // "Date: ...\r\n"，每个线程每秒最多格式化一次
+    static std::string_view dateHeader()
+    {
+        thread_local time_t cachedSecond = 0;
+        thread_local char buf[64];
+        thread_local size_t len = 0;
+
+        time_t now = ::time(nullptr);
+        if (now != cachedSecond)
+        {
+            struct tm tm;
+            ::gmtime_r(&now, &tm);
+            len = ::strftime(buf, sizeof buf, "Date: %a, %d %b %Y %H:%M:%S GMT\r\n", &tm);
+            cachedSecond = now;
+        }
+        return std::string_view(buf, len);
+    }
+
 private:
+    static constexpr size_t kOwnArenaSize = 512;
+    static constexpr size_t kArenaBodyMax = 64 * 1024;
+    static constexpr std::string_view kDefaultVersion = "HTTP/1.1";
+
+    enum BodyStorage
+    {
+        kOwnedBody,    // ownedBody_
+        kArenaBody,    // bodyView_ 指向 arena()
+        kBorrowedBody, // bodyView_ 指向调用方的数据
+    };
+
     HttpStatusCode statusCode_;
-    std::string version_;
-    std::string body_;
-    std::map<std::string, std::string> headers_;
+    std::string_view version_; // 默认版本指向常量，其他的拷贝到 arena()
+    std::string ownedBody_;
+    std::string_view bodyView_;
+    BodyStorage bodyStorage_;
+    bool suppressBody_;
+    Arena *arena_;                    // 外部传入的 Arena
+    std::unique_ptr<Arena> ownArena_; // 没有传入时自己创建
+    HeaderMap headers_; // 名字和值都指向 arena()
 };
@@ -2,20 +2,43 @@
 #include "HttpRequest.h"
 #include "HttpRequestParser.h"
 #include "PerformanceMonitor.h"
-#include <iostream>
-#include <random>
+#include "Logger.h"
+#include "Awaitables.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <future>
+
+namespace
+{
+    // 协程路由的根协程：持有完成对象，请求在处理函数结束前一直有效。
+    // 处理函数抛出异常时完成对象随之释放，自动回复 500
+    DetachedTask runCoroutineHandler(const Router::CoroutineHandlerCallback *handler, ResponseCompletionPtr done)
+    {
+        try
+        {
+            HttpResponse response = co_await (*handler)(done->request());
+            done->complete(&response);
+        }
+        catch (const std::exception &e)
+        {
+            LOG_ERROR("Coroutine handler for request %016llx threw: %s",
+                      static_cast<unsigned long long>(done->request().requestId()), e.what());
+        }
+    }
+}
 
 HttpServer::HttpServer(EventLoop *loop,
                        const InetAddress &listenAddr,
-                       const std::string &name)
-    : server_(loop, listenAddr, name), performanceMonitoringEnabled_(false)
+                       const std::string &name,
+                       AcceptMode mode)
+    : server_(loop, listenAddr, name, mode == kReusePort ? TcpServer::kReusePort : TcpServer::kNoReusePort),
+      listenAddr_(listenAddr),
+      name_(name),
+      acceptMode_(mode),
+      performanceMonitoringEnabled_(false)
 {
-    
-    // 设置默认的请求处理函数，使用路由器处理请求
-    requestHandler_ = [this](const HttpRequest &req, HttpResponse *resp)
-    {
-        router_.route(req, resp);
-    };
 
     // 设置连接回调
     server_.setConnectionCallback(
@@ -25,14 +48,208 @@ HttpServer::HttpServer(EventLoop *loop,
     server_.setMessageCallback(
         std::bind(&HttpServer::onMessage, this, std::placeholders::_1,
                   std::placeholders::_2, std::placeholders::_3));
+
+    // 每个 IO 线程启动时创建自己的时间轮
+    server_.setThreadInitCallback(
+        std::bind(&HttpServer::onThreadInit, this, std::placeholders::_1));
+}
+
+HttpServer::~HttpServer()
+{
+    // TcpServer 只能在自己的 loop 中销毁，之后 EventLoopThread 析构时退出循环并等待线程结束
+    for (auto &listener : listeners_)
+    {
+        TcpServer *server = listener.release();
+        server->getLoop()->runInLoop([server]()
+                                     { delete server; });
+    }
+    listenerThreads_.clear();
+}
+
+void HttpServer::startListeners()
+{
+    // 监听 loop 的 TcpServer 不再创建子线程，连接就在接受它的线程中处理，新连接不需要跨线程转交。
+    // 线程初始化回调在新线程中、进入事件循环之前执行
+    for (int i = 1; i < numThreads_; ++i)
+    {
+        auto thread = std::make_unique<EventLoopThread>(
+            std::bind(&HttpServer::onThreadInit, this, std::placeholders::_1),
+            name_ + "-io" + std::to_string(i));
+        EventLoop *ioLoop = thread->startLoop();
+
+        // TcpServer 属于 ioLoop，只能在该线程中创建和 start，主线程等待它开始监听
+        std::unique_ptr<TcpServer> listener;
+        std::promise<void> started;
+        ioLoop->runInLoop([this, ioLoop, &listener, &started]()
+                          {
+                              listener = std::make_unique<TcpServer>(ioLoop, listenAddr_, name_, TcpServer::kReusePort);
+                              listener->setConnectionCallback(
+                                  std::bind(&HttpServer::onConnection, this, std::placeholders::_1));
+                              listener->setMessageCallback(
+                                  std::bind(&HttpServer::onMessage, this, std::placeholders::_1,
+                                            std::placeholders::_2, std::placeholders::_3));
+                              listener->start();
+                              started.set_value(); });
+        started.get_future().wait();
+
+        listenerThreads_.push_back(std::move(thread));
+        listeners_.push_back(std::move(listener));
+    }
+    LOG_INFO("%s: %d SO_REUSEPORT listeners on %s", name_.c_str(), numThreads_ > 0 ? numThreads_ : 1,
+             listenAddr_.toIpPort().c_str());
+}
+
+void HttpServer::onThreadInit(EventLoop *loop)
+{
+    auto state = std::make_unique<HttpLoopState>();
+    TimerWheel *wheel = &state->wheel;
+    FramePool *frames = &state->framePool;
+    {
+        std::lock_guard<std::mutex> lock(loopStatesMutex_);
+        state->threadIndex = static_cast<uint16_t>(loopStates_.size());
+        if (accessLog_)
+        {
+            state->accessRing = accessLog_->createRing();
+        }
+        if (!rateLimits_.empty())
+        {
+            state->rateLimiter.reset(rateLimitCapacity_);
+        }
+        if (compression_)
+        {
+            state->fileCache.setEncodeWorkers(workerPool_.get(), loop);
+        }
+        loopStates_[loop] = std::move(state);
+    }
+
+    // 协程帧从本线程的内存池分配，等待操作通过本线程的 EventLoop 恢复
+    FramePool::current() = frames;
+    CoroutineEnv::current().loop = loop;
+    CoroutineEnv::current().pool = workerPool_.get();
+
+    // 时间轮每秒前进一格
+    loop->runEvery(1.0, [wheel]()
+                   { wheel->tick(); });
+}
+
+HttpLoopState *HttpServer::loopState(EventLoop *loop)
+{
+    std::lock_guard<std::mutex> lock(loopStatesMutex_);
+    return loopStates_.at(loop).get();
+}
+
+HttpResponse::HttpStatusCode HttpServer::parseErrorStatus(HttpRequestParser::HttpRequestParseResult result)
+{
+    switch (result)
+    {
+    case HttpRequestParser::kUriTooLong:
+        return HttpResponse::k414UriTooLong;
+    case HttpRequestParser::kHeaderTooLarge:
+        return HttpResponse::k431RequestHeaderFieldsTooLarge;
+    case HttpRequestParser::kBodyTooLarge:
+        return HttpResponse::k413PayloadTooLarge;
+    default:
+        return HttpResponse::k400BadRequest;
+    }
+}
+
+void HttpServer::appendErrorResponse(HttpContext &ctx, HttpResponse::HttpStatusCode status, std::string *output)
+{
+    HttpResponse response(&ctx.loopState->arena);
+    response.setStatusCode(status);
+    response.setContentType("text/plain");
+    response.setBody({std::to_string(status), " ", HttpResponse::statusCodeToString(status)});
+    response.addHeader("Connection", "close");
+    response.appendToBuffer(output);
+    ctx.request.status = status;
+    ctx.closing = true;
+}
+
+void HttpServer::armTimeout(HttpContext &ctx)
+{
+    // 读头部和读请求体的超时是从该阶段开始计算的截止时间，不因收到新数据而推迟，
+    // 逐字节慢速发送的客户端（slowloris）最多占用连接这么长时间
+    // 流式接收的请求体可能很大，改为按没有收到新数据的时间计算，每次处理后重新计时
+    HttpRequestParser::Phase phase = ctx.parser.phase();
+    if (phase != HttpRequestParser::kIdle && ctx.timer.armed() && !ctx.bodyStream &&
+        phase == ctx.timerPhase && ctx.request.id == ctx.timerRequestId)
+    {
+        return;
+    }
+    ctx.timerPhase = phase;
+    ctx.timerRequestId = ctx.request.id;
+
+    int timeout = idleTimeout_;
+    switch (phase)
+    {
+    case HttpRequestParser::kReadingHeaders:
+        timeout = headerTimeout_;
+        break;
+    case HttpRequestParser::kReadingBody:
+        timeout = bodyTimeout_;
+        break;
+    default:
+        break;
+    }
+
+    // 等待异步处理函数、BodyStream 暂停接收时不计超时
+    if (timeout > 0 && !ctx.asyncPending && !ctx.bodyPaused)
+    {
+        ctx.loopState->wheel.arm(&ctx.timer, static_cast<uint32_t>(timeout));
+    }
+    else
+    {
+        ctx.loopState->wheel.cancel(&ctx.timer);
+    }
 }
 
 void HttpServer::onConnection(const TcpConnectionPtr &conn)
 {
     if (conn->connected())
     {
-        std::cout << "New connection: " << conn->peerAddress().toIpPort() << std::endl;
-        conn->setContext(HttpRequestParser()); // 设置上下文
+        LOG_DEBUG("New connection: %s", conn->peerAddress().toIpPort().c_str());
+        // 设置上下文
+        HttpContextPtr ctx = std::make_shared<HttpContext>();
+        ctx->loopState = loopState(conn->getLoop());
+        ctx->parser.setLimits(&requestLimits_);
+        ctx->parser.setStopAtBody(hasStreamRoutes_);
+        if (accessLog_)
+        {
+            ctx->peer = conn->peerAddress().toIpPort();
+        }
+
+        // 超时直接断开连接，回调只持有弱引用
+        std::weak_ptr<TcpConnection> weakConn(conn);
+        ctx->timer.setCallback([weakConn]()
+                               {
+                                   if (TcpConnectionPtr c = weakConn.lock())
+                                   {
+                                       c->forceClose();
+                                   } });
+        if (!rateLimits_.empty())
+        {
+            ctx->peerKey = RateLimiter::hash(conn->peerAddress().toIp());
+        }
+        armTimeout(*ctx);
+        conn->setContext(ctx);
+
+        // 连接数超过上限：回复 503 后关闭，不再读取请求
+        if (maxConnections_ > 0 &&
+            connectionCount_.fetch_add(1, std::memory_order_relaxed) >= maxConnections_)
+        {
+            rejectedConnections_.fetch_add(1, std::memory_order_relaxed);
+            ctx->closing = true;
+            std::string output;
+            overloadResponse_->appendTo(&output, "Connection: close\r\n", false);
+            conn->send(output);
+            conn->shutdown();
+        }
+        else if (outputHighWaterMark_ > 0)
+        {
+            conn->setHighWaterMarkCallback(
+                std::bind(&HttpServer::onHighWaterMark, this, std::placeholders::_1, std::placeholders::_2),
+                outputHighWaterMark_);
+        }
         
         // 如果启用了性能监控，记录连接增加
         if (performanceMonitoringEnabled_) {
@@ -41,7 +258,18 @@ void HttpServer::onConnection(const TcpConnectionPtr &conn)
     }
     else
     {
-        std::cout << "Connection closed: " << conn->peerAddress().toIpPort() << std::endl;
+        LOG_DEBUG("Connection closed: %s", conn->peerAddress().toIpPort().c_str());
+        HttpContext &ctx = *conn->getContext<HttpContextPtr>();
+        ctx.timer.unlink();
+        if (ctx.bodyStream)
+        {
+            ctx.bodyStream->onBodyAbort();
+            ctx.bodyStream.reset();
+        }
+        if (maxConnections_ > 0)
+        {
+            connectionCount_.fetch_sub(1, std::memory_order_relaxed);
+        }
         
         // 如果启用了性能监控，记录连接减少
         if (performanceMonitoringEnabled_) {
@@ -52,97 +280,900 @@ void HttpServer::onConnection(const TcpConnectionPtr &conn)
 
 void HttpServer::onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp receiveTime)
 {
-    // 生成请求ID用于性能监控
-    std::string requestId = generateRequestId();
-    
-    // 如果启用了性能监控，记录请求开始
-    if (performanceMonitoringEnabled_) {
-        PerformanceMonitor::getInstance().startRequest(requestId);
+    HttpContext &ctx = *conn->getContext<HttpContextPtr>();
+    ctx.input = buf;
+    ctx.lastReceiveTime = receiveTime;
+
+    // 已决定关闭的连接不再处理任何数据
+    if (ctx.closing)
+    {
+        buf->retrieveAll();
+        return;
     }
-    
-    // 获取连接的解析器
-    HttpRequestParser &parser = conn->getContext<HttpRequestParser>();
 
-    // 解析请求
-    const char *data = buf->peek();
-    size_t len = buf->readableBytes();
+    // 文件响应体还没发完、异步请求还没完成、输出超过高水位或 BodyStream 暂停接收时，
+    // 新数据留在缓冲区里，等恢复后再处理
+    if (ctx.fileBody.active() || ctx.asyncPending || ctx.outputBlocked || ctx.bodyPaused)
+    {
+        // 等待期间对端继续发送的数据超过一个最大请求时停止读取，恢复处理时再继续
+        if (!ctx.readPaused && buf->readableBytes() > requestLimits_.maxRequestSize())
+        {
+            ctx.readPaused = true;
+            conn->stopRead();
+        }
+        return;
+    }
 
-    HttpRequestParser::HttpRequestParseResult result =
-        parser.parse(data, data + len);
+    processInput(conn, ctx);
+}
+
+void HttpServer::processInput(const TcpConnectionPtr &conn, HttpContext &ctx)
+{
+    Buffer *buf = ctx.input;
+    HttpRequestParser &parser = ctx.parser;
 
-    bool requestSuccess = false;  // 用于记录请求是否成功
+    // 本次可读事件产生的所有响应先拼接在一起，最后只调用一次 send。
+    // onMessage 总在连接所属的 IO 线程执行，send 在本线程内会同步写出或拷贝进输出缓冲区，
+    // 因此可以复用线程局部的缓冲区
+    static thread_local std::string output;
+    output.clear();
 
-    if (result == HttpRequestParser::kOk)
+    // 流水线请求：循环处理 Buffer 中所有完整的请求，每次只消费该请求自己的字节
+    while (ctx.bodyStream || buf->readableBytes() > 0)
     {
-        // 解析成功，处理请求
-        const HttpRequest &request = parser.request();
-        HttpResponse response;
+        // 流式请求体：已到达的部分直接交给 BodyStream，不在缓冲区中积累
+        if (ctx.bodyStream)
+        {
+            if (!processBodyStream(conn, ctx, &output) || ctx.closing)
+            {
+                break;
+            }
+            continue;
+        }
 
-        std::cout << "Parsed request: " << std::endl;
-        std::cout << "Method: " << request.method() << std::endl;
-        std::cout << "Path: " << request.path() << std::endl;
+        // 新请求的第一个字节：分配请求 ID 并记录开始时间
+        if (parser.phase() == HttpRequestParser::kIdle)
+        {
+            ctx.request.begin(ctx.loopState->nextRequestId(), ctx.lastReceiveTime);
+        }
 
-        // 如果启用了性能监控，记录请求路径
-        if (performanceMonitoringEnabled_) {
-            PerformanceMonitor::getInstance().recordPath(request.path());
+        const char *data = buf->peek();
+        HttpRequestParser::HttpRequestParseResult result =
+            parser.parse(data, data + buf->readableBytes());
+
+        if (result == HttpRequestParser::kNotComplete)
+        {
+            // 请求不完整，等待更多数据
+            break;
+        }
+
+        ctx.request.parsedNs = RequestContext::nowNs();
+
+        if (result == HttpRequestParser::kHeadersComplete)
+        {
+            // 流式路由从这里接管请求体，在循环开头边到达边处理
+            if (startBodyStream(conn, ctx, &output))
+            {
+                if (ctx.closing)
+                {
+                    break;
+                }
+                continue;
+            }
+            // 其他路由照常等待完整的请求体
+            result = parser.parse(data, data + buf->readableBytes());
+            if (result == HttpRequestParser::kNotComplete)
+            {
+                break;
+            }
         }
 
-        // 调用请求处理函数
-        if (getRequestHandler())
+        bool requestSuccess = false;  // 用于记录请求是否成功
+        size_t outputBefore = output.size();
+
+        if (result == HttpRequestParser::kOk)
         {
-            // 调用注册的请求处理器
-            std::cout << "Calling request handler..." << std::endl;
-            getRequestHandler()(request, &response);
-            requestSuccess = true;  // 请求处理成功
+            parser.request().setRequestId(ctx.request.id);
+            requestSuccess = handleRequest(conn, parser.request(), ctx, &output);
+
+            if (ctx.asyncPending)
+            {
+                // 请求已拷贝给异步处理函数，访问日志和性能统计在完成时记录
+                buf->retrieve(parser.consumed());
+                parser.reset();
+                break;
+            }
+
+            // 访问日志要在请求的字节被 retrieve 之前记录
+            if (accessLog_)
+            {
+                uint64_t bytes = output.size() - outputBefore + ctx.fileBody.remaining;
+                ctx.request.handledNs = RequestContext::nowNs();
+                accessLog_->log(ctx.loopState->accessRing, ctx.request, ctx.peer,
+                                &parser.request(), ctx.request.status, bytes);
+            }
+
+            // 只清空当前请求占用的数据，后续流水线请求留在缓冲区中
+            buf->retrieve(parser.consumed());
+
+            // 重置解析器状态，准备处理下一个请求
+            parser.reset();
         }
         else
         {
-            // 没有设置处理函数，返回404
-            std::cout << "No request handler set, returning 404" << std::endl;
-            response.setStatusCode(HttpResponse::k404NotFound);
-            response.setContentType("text/plain");
-            response.setBody("404 Not Found");
+            // 请求格式错误返回 400，超过大小限制返回 413 / 414 / 431，之后关闭连接
+            HttpResponse::HttpStatusCode status = parseErrorStatus(result);
+            LOG_DEBUG("Bad request from %s, sending %d response", conn->peerAddress().toIpPort().c_str(),
+                      static_cast<int>(status));
+            appendErrorResponse(ctx, status, &output);
+
+            if (accessLog_)
+            {
+                ctx.request.handledNs = RequestContext::nowNs();
+                accessLog_->log(ctx.loopState->accessRing, ctx.request, ctx.peer,
+                                nullptr, ctx.request.status, output.size() - outputBefore);
+            }
+
+            // 无法确定错误请求的边界，清空缓冲区
+            buf->retrieveAll();
+
+            // 重置解析器状态
+            parser.reset();
         }
 
-        // 发送响应
-        std::string responseStr = response.toString();
-        std::cout << "Sending response: " << responseStr << std::endl;
-        conn->send(responseStr);
+        // 本次请求的响应已经序列化到 output，回收其在 Arena 中的数据
+        ctx.loopState->arena.reset();
+        ctx.request.handledNs = RequestContext::nowNs();
 
-        // 清空已处理的数据
-        buf->retrieve(len);
+        // 如果启用了性能监控，记录请求的处理耗时
+        if (performanceMonitoringEnabled_) {
+            PerformanceMonitor::getInstance().recordRequest(ctx.request.handleNs(), requestSuccess);
+        }
 
-        // 重置解析器状态，准备处理下一个请求
-        parser.reset();
+        if (ctx.closing || ctx.fileBody.active())
+        {
+            break;
+        }
+
+        // 流水线响应积累过多：先发出去，对端读走之后再处理剩下的请求
+        if (outputHighWaterMark_ > 0 && output.size() >= outputHighWaterMark_ && buf->readableBytes() > 0)
+        {
+            ctx.outputBlocked = true;
+            break;
+        }
     }
-    else if (result == HttpRequestParser::kBadRequest)
+
+    // 响应头发送完成后开始分块发送文件内容，或者输出发送完后继续处理。写完成回调必须在 send 之前安装：
+    // 输出一次就写完时，TcpConnection 只在回调已经设置的情况下才排队调用它
+    bool awaitWrite = ctx.fileBody.active() || ctx.outputBlocked;
+    if (awaitWrite)
     {
-        // 请求格式错误，返回400
-        HttpResponse response;
-        response.setStatusCode(HttpResponse::k400BadRequest);
-        response.setContentType("text/plain");
-        response.setBody("400 Bad Request");
+        conn->setWriteCompleteCallback(
+            std::bind(&HttpServer::onWriteComplete, this, std::placeholders::_1));
+    }
 
-        std::string responseStr = response.toString();
-        std::cout << "Bad request, sending 400 response." << std::endl;
-        conn->send(responseStr);
+    // 发送响应
+    if (!output.empty())
+    {
+        conn->send(output);
+    }
 
-        // 清空缓冲区
+    if (!awaitWrite && ctx.closing && !ctx.asyncPending)
+    {
+        // 丢弃关闭之后的流水线请求，输出缓冲区发送完毕后关闭写端；
+        // 对端迟迟不关闭时由空闲超时强制断开
         buf->retrieveAll();
+        conn->shutdown();
+    }
+    armTimeout(ctx);
+}
+
+void HttpServer::onWriteComplete(const TcpConnectionPtr &conn)
+{
+    HttpContext &ctx = *conn->getContext<HttpContextPtr>();
+    if (ctx.fileBody.active())
+    {
+        sendFileChunk(conn, ctx);
+        armTimeout(ctx);
+        return;
+    }
+
+    // 文件发送完毕，或积压的输出已经发送完
+    conn->setWriteCompleteCallback(WriteCompleteCallback());
+    ctx.fileBody.reset();
+    ctx.outputBlocked = false;
+    if (ctx.readPaused && !ctx.bodyPaused)
+    {
+        ctx.readPaused = false;
+        conn->startRead();
+    }
+    if (ctx.asyncPending)
+    {
+        // 高水位回调可能发生在异步请求处理期间，剩下的工作由完成回调继续
+        return;
+    }
+    if (ctx.closing)
+    {
+        ctx.input->retrieveAll();
+        conn->shutdown();
+    }
+    else if (ctx.input->readableBytes() > 0 || (ctx.bodyStream && !ctx.bodyPaused))
+    {
+        // 继续处理文件发送期间到达的流水线请求或流式请求体
+        processInput(conn, ctx);
+        return;
+    }
+    armTimeout(ctx);
+}
+
+void HttpServer::sendFileChunk(const TcpConnectionPtr &conn, HttpContext &ctx)
+{
+    // 每次最多发送一块，避免大文件一次性拷贝进输出缓冲区
+    static const size_t kChunkSize = 64 * 1024;
+    // TcpConnection 不暴露套接字描述符，也不能在输出缓冲区之后排队一段文件区间，用不了 sendfile/splice。
+    // 大文件每块 pread 到本线程的缓冲区再发送，只拷贝一次；文件被截断时 pread 读不满而不会触发 SIGBUS
+    static thread_local std::string fileChunk;
+
+    FileBody &body = ctx.fileBody;
+    std::string_view piece;
+    if (!body.encoder)
+    {
+        if (!body.next(kChunkSize, &fileChunk, &piece))
+        {
+            abortTruncatedFile(conn, ctx);
+            return;
+        }
+        conn->send(piece.data(), piece.size());
+        return;
+    }
+
+    // 流式压缩：压缩器可能暂存数据而不产生输出，继续读取直到有输出或文件结束，
+    // 每次的输出作为一个 chunk 发送，最后附上结束块
+    static thread_local std::string encoded;
+    static thread_local std::string chunk;
+    encoded.clear();
+    bool ok = true;
+    while (ok && encoded.empty() && body.remaining > 0)
+    {
+        if (!body.next(kChunkSize, &fileChunk, &piece))
+        {
+            abortTruncatedFile(conn, ctx);
+            return;
+        }
+        ok = body.encoder->write(piece, &encoded);
+    }
+    if (ok && body.remaining == 0)
+    {
+        ok = body.encoder->finish(&encoded);
+    }
+    if (!ok)
+    {
+        // 响应头已经发出，只能断开连接
+        LOG_ERROR("Compression failed for request %016llx", static_cast<unsigned long long>(ctx.request.id));
+        body.remaining = 0;
+        conn->forceClose();
+        return;
+    }
+
+    char size[24];
+    int len = snprintf(size, sizeof size, "%zx\r\n", encoded.size());
+    chunk.assign(size, static_cast<size_t>(len));
+    chunk.append(encoded);
+    chunk.append("\r\n", 2);
+    if (body.remaining == 0)
+    {
+        chunk.append("0\r\n\r\n", 5);
+    }
+    conn->send(chunk);
+}
+
+void HttpServer::abortTruncatedFile(const TcpConnectionPtr &conn, HttpContext &ctx)
+{
+    // 文件在发送期间被截断，剩下的内容读不出来；响应头已经发出，只能断开连接
+    LOG_ERROR("File truncated while serving request %016llx", static_cast<unsigned long long>(ctx.request.id));
+    ctx.fileBody.remaining = 0;
+    conn->forceClose();
+}
+
+bool HttpServer::startRequest(const HttpRequest &request, HttpContext &ctx)
+{
+    // 决定本次响应之后是否保持连接
+    ++ctx.requestCount;
+    bool keepAlive = keepAlive_ && request.keepAlive();
+    if (maxRequestsPerConnection_ > 0 && ctx.requestCount >= maxRequestsPerConnection_)
+    {
+        keepAlive = false;
+    }
+
+    LOG_DEBUG("Request %016llx: %s %.*s", static_cast<unsigned long long>(request.requestId()),
+              HttpRequest::methodToString(request.method()).c_str(),
+              static_cast<int>(request.path().size()), request.path().data());
+    return keepAlive;
+}
+
+void HttpServer::recordRoute(const Router::Route *route)
+{
+    // 如果启用了性能监控，按匹配到的路由模式统计，没有匹配的请求共用一个槽位
+    if (performanceMonitoringEnabled_)
+    {
+        PerformanceMonitor::getInstance().recordPath(route != nullptr ? route->statsSlot
+                                                                       : PerformanceMonitor::kUnmatchedPath);
+    }
+}
+
+bool HttpServer::handleRequest(const TcpConnectionPtr &conn, HttpRequest &request, HttpContext &ctx,
+                               std::string *output)
+{
+    bool keepAlive = startRequest(request, ctx);
+    if (!keepAlive)
+    {
+        ctx.closing = true;
+    }
+    bool headOnly = request.method() == HttpRequest::kHead;
+
+    // 限流在路由之前进行，被拒绝的请求不再查找路由
+    if (!rateLimits_.empty() && !checkRateLimit(request, ctx, keepAlive, output))
+    {
+        return false;
+    }
+
+    // 设置了自定义处理函数时使用它，否则交给路由器
+    const Router::Route *route = requestHandler_ ? nullptr : router_.match(request);
+    recordRoute(route);
+
+    // 静态响应直接拷贝预先序列化好的字节
+    if (route != nullptr && route->prepared)
+    {
+        const PreparedResponse &prepared = selectVariant(*route->prepared, request);
+        prepared.appendTo(output, responseHeaders(request, keepAlive), headOnly);
+        ctx.request.status = prepared.statusCode();
+        return true;
+    }
+
+    // 静态文件
+    if (route != nullptr && route->files)
+    {
+        ctx.request.status = handleFileRequest(route, request, ctx, keepAlive, output);
+        return true;
+    }
+
+    // 处理中的异步请求过多时直接回复 503，不再占用工作线程和协程
+    if (route != nullptr && (route->asyncHandler || route->coroutineHandler) && !admitInflight())
+    {
+        shedRequests_.fetch_add(1, std::memory_order_relaxed);
+        overloadResponse_->appendTo(output, responseHeaders(request, keepAlive), headOnly);
+        ctx.request.status = overloadResponse_->statusCode();
+        return false;
+    }
+
+    // 异步路由交给工作线程池
+    if (route != nullptr && route->asyncHandler)
+    {
+        dispatchAsync(conn, route, request, ctx, keepAlive);
+        return true;
+    }
+
+    if (route != nullptr && route->coroutineHandler)
+    {
+        dispatchCoroutine(conn, route, request, ctx, keepAlive);
+        return true;
+    }
+
+    // 可缓存的路由先查响应缓存
+    if (route != nullptr && route->cache && responseCache_ &&
+        (request.method() == HttpRequest::kGet || headOnly))
+    {
+        ctx.request.status = handleCachedRequest(route, request, ctx, keepAlive, output);
+        return true;
+    }
+
+    // 解析成功，处理请求
+    HttpResponse response(&ctx.loopState->arena);
+    if (requestHandler_)
+    {
+        requestHandler_(request, &response);
+    }
+    else
+    {
+        router_.dispatch(route, request, &response);
+    }
+
+    ctx.request.status = writeResponse(request, keepAlive, &response, output);
+    return true;
+}
+
+ResponseCompletionPtr HttpServer::makeCompletion(const TcpConnectionPtr &conn, HttpRequest &request,
+                                                 HttpContext &ctx, bool keepAlive)
+{
+    auto detached = std::make_shared<const DetachedRequest>(request, ctx.input->peek(), ctx.parser.consumed());
+
+    // 完成对象可能在任意线程被调用：在调用线程上序列化，再回到连接所属的 IO 线程发送。
+    // 使用 queueInLoop 而不是 runInLoop，处理函数在 IO 线程中同步完成时也不会重入 processInput
+    std::weak_ptr<TcpConnection> weakConn(conn);
+    EventLoop *loop = conn->getLoop();
+    auto finisher = [this, weakConn, loop, keepAlive](const DetachedRequestPtr &req, HttpResponse *response)
+    {
+        releaseInflight();
+        auto output = std::make_shared<std::string>();
+        HttpResponse::HttpStatusCode status = writeResponse(req->request, keepAlive, response, output.get());
+        loop->queueInLoop([this, weakConn, req, output, status]()
+                          { onAsyncComplete(weakConn, req, *output, status); });
+    };
+    ctx.asyncPending = true;
+    return std::make_shared<ResponseCompletion>(detached, std::move(finisher));
+}
+
+void HttpServer::dispatchAsync(const TcpConnectionPtr &conn, const Router::Route *route,
+                               HttpRequest &request, HttpContext &ctx, bool keepAlive)
+{
+    ResponseCompletionPtr completion = makeCompletion(conn, request, ctx, keepAlive);
+
+    // 路由表在启动后不再修改，可以直接引用其中的处理函数
+    const Router::AsyncHandlerCallback *handler = &route->asyncHandler;
+    auto run = [handler, completion]()
+    {
+        try
+        {
+            (*handler)(completion->request(), completion);
+        }
+        catch (const std::exception &e)
+        {
+            // 完成对象随之释放，未完成时回复 500
+            LOG_ERROR("Async handler for request %016llx threw: %s",
+                      static_cast<unsigned long long>(completion->request().requestId()), e.what());
+        }
+    };
 
-        // 重置解析器状态
-        parser.reset();
+    if (workerPool_)
+    {
+        workerPool_->submit(std::move(run));
     }
     else
     {
-        // 请求不完整，等待更多数据
+        run();
+    }
+}
+
+void HttpServer::dispatchCoroutine(const TcpConnectionPtr &conn, const Router::Route *route,
+                                   HttpRequest &request, HttpContext &ctx, bool keepAlive)
+{
+    // 协程在遇到第一个等待操作之前同步执行；完成时与异步路由一样把响应投递回本线程发送
+    runCoroutineHandler(&route->coroutineHandler, makeCompletion(conn, request, ctx, keepAlive));
+}
+
+void HttpServer::onAsyncComplete(const std::weak_ptr<TcpConnection> &weakConn, const DetachedRequestPtr &request,
+                                 const std::string &output, HttpResponse::HttpStatusCode status)
+{
+    TcpConnectionPtr conn = weakConn.lock();
+    if (!conn || !conn->connected())
+    {
+        return;
+    }
+
+    HttpContext &ctx = *conn->getContext<HttpContextPtr>();
+    ctx.asyncPending = false;
+    if (ctx.readPaused && !ctx.outputBlocked)
+    {
+        ctx.readPaused = false;
+        conn->startRead();
+    }
+    ctx.request.status = status;
+    ctx.request.handledNs = RequestContext::nowNs();
+    if (accessLog_)
+    {
+        accessLog_->log(ctx.loopState->accessRing, ctx.request, ctx.peer, &request->request,
+                        status, output.size());
+    }
+    if (performanceMonitoringEnabled_)
+    {
+        PerformanceMonitor::getInstance().recordRequest(ctx.request.handleNs(), status < 500);
+    }
+
+    conn->send(output);
+    if (ctx.closing)
+    {
+        ctx.input->retrieveAll();
+        conn->shutdown();
+    }
+    else if (ctx.input->readableBytes() > 0)
+    {
+        // 继续处理等待期间到达的流水线请求
+        processInput(conn, ctx);
+        return;
+    }
+    armTimeout(ctx);
+}
+
+bool HttpServer::startBodyStream(const TcpConnectionPtr &conn, HttpContext &ctx, std::string *output)
+{
+    HttpRequestParser &parser = ctx.parser;
+    HttpRequest &request = parser.request();
+    const Router::Route *route = requestHandler_ ? nullptr : router_.match(request);
+    if (route == nullptr || !route->bodyStream)
+    {
+        return false;
+    }
+
+    request.setRequestId(ctx.request.id);
+    size_t outputBefore = output->size();
+    bool keepAlive = startRequest(request, ctx);
+    recordRoute(route);
+
+    // 请求头拷贝出缓冲区，之后缓冲区中只保留还没交给 BodyStream 的请求体
+    ctx.streamRequest = std::make_shared<const DetachedRequest>(request, ctx.input->peek(), parser.consumed());
+    ctx.input->retrieve(parser.consumed());
+    const HttpRequest &head = ctx.streamRequest->request;
+
+    BodyStreamPtr stream;
+    if (rateLimits_.empty() || checkRateLimit(head, ctx, false, output))
+    {
+        if (!parser.streamBody())
+        {
+            appendErrorResponse(ctx, HttpResponse::k413PayloadTooLarge, output);
+        }
+        else
+        {
+            HttpResponse response(&ctx.loopState->arena);
+            stream = route->bodyStream(head, &response);
+            if (!stream)
+            {
+                ctx.request.status = writeResponse(head, false, &response, output);
+            }
+        }
+    }
+    if (!stream)
+    {
+        // 被拒绝的请求不再读取请求体，响应之后关闭连接
+        ctx.closing = true;
+        finishBodyStream(ctx, false, output->size() - outputBefore);
+        return true;
+    }
+
+    // 客户端等待确认后才发送请求体
+    if (head.version() == "HTTP/1.1" &&
+        HttpRequest::equalsIgnoreCase(head.getHeader(HttpHeader::kExpect), "100-continue"))
+    {
+        output->append("HTTP/1.1 100 Continue\r\n\r\n");
+    }
+
+    // 使用 queueInLoop，BodyStream 在 onBodyChunk 中调用 resume 也不会重入 processInput
+    std::weak_ptr<TcpConnection> weakConn(conn);
+    EventLoop *loop = conn->getLoop();
+    uint64_t requestId = ctx.request.id;
+    stream->resume_ = [this, weakConn, loop, requestId]()
+    {
+        loop->queueInLoop([this, weakConn, requestId]()
+                          { resumeBodyStream(weakConn, requestId); });
+    };
+    ctx.bodyStream = std::move(stream);
+    ctx.streamKeepAlive = keepAlive;
+    return true;
+}
+
+bool HttpServer::processBodyStream(const TcpConnectionPtr &conn, HttpContext &ctx, std::string *output)
+{
+    if (ctx.bodyPaused)
+    {
+        return false;
+    }
+
+    Buffer *buf = ctx.input;
+    BodyStream *stream = ctx.bodyStream.get();
+    bool paused = false;
+    size_t consumed = 0;
+    const char *data = buf->peek();
+    HttpRequestParser::HttpRequestParseResult result =
+        ctx.parser.parseBody(data, data + buf->readableBytes(), &consumed,
+                             [stream, &paused](const char *chunk, size_t len)
+                             {
+                                 paused = !stream->onBodyChunk(std::string_view(chunk, len));
+                                 return !paused;
+                             });
+    buf->retrieve(consumed);
+
+    size_t outputBefore = output->size();
+    if (result != HttpRequestParser::kOk && result != HttpRequestParser::kNotComplete)
+    {
+        // 请求体格式错误或超过上限：通知 BodyStream，回复错误后关闭连接
+        LOG_DEBUG("Bad request body from %s", conn->peerAddress().toIpPort().c_str());
+        stream->onBodyAbort();
+        appendErrorResponse(ctx, parseErrorStatus(result), output);
+        buf->retrieveAll();
+        finishBodyStream(ctx, false, output->size() - outputBefore);
+        return true;
+    }
+    if (paused)
+    {
+        // BodyStream 处理不过来：停止读取，resume 之后继续，请求体最后一段也要等 resume 之后才结束
+        ctx.bodyPaused = true;
+        if (!ctx.readPaused)
+        {
+            ctx.readPaused = true;
+            conn->stopRead();
+        }
+        return false;
+    }
+    if (result == HttpRequestParser::kNotComplete)
+    {
+        return false;
+    }
+
+    HttpResponse response(&ctx.loopState->arena);
+    stream->onBodyEnd(&response);
+    ctx.request.status = writeResponse(ctx.streamRequest->request, ctx.streamKeepAlive, &response, output);
+    if (!ctx.streamKeepAlive)
+    {
+        ctx.closing = true;
+    }
+    finishBodyStream(ctx, ctx.request.status < 500, output->size() - outputBefore);
+    return true;
+}
+
+void HttpServer::finishBodyStream(HttpContext &ctx, bool success, uint64_t bytes)
+{
+    ctx.request.handledNs = RequestContext::nowNs();
+    if (accessLog_)
+    {
+        accessLog_->log(ctx.loopState->accessRing, ctx.request, ctx.peer, &ctx.streamRequest->request,
+                        ctx.request.status, bytes);
+    }
+    if (performanceMonitoringEnabled_)
+    {
+        PerformanceMonitor::getInstance().recordRequest(ctx.request.handleNs(), success);
+    }
+    ctx.bodyStream.reset();
+    ctx.streamRequest.reset();
+    ctx.bodyPaused = false;
+    ctx.parser.reset();
+    ctx.loopState->arena.reset();
+}
+
+void HttpServer::resumeBodyStream(const std::weak_ptr<TcpConnection> &weakConn, uint64_t requestId)
+{
+    TcpConnectionPtr conn = weakConn.lock();
+    if (!conn || !conn->connected())
+    {
+        return;
+    }
+
+    // 请求已经结束时是过期的 resume
+    HttpContext &ctx = *conn->getContext<HttpContextPtr>();
+    if (!ctx.bodyPaused || ctx.request.id != requestId)
+    {
+        return;
+    }
+    ctx.bodyPaused = false;
+    if (ctx.fileBody.active() || ctx.outputBlocked)
+    {
+        // 输出发送完后由写完成回调恢复读取并继续处理
+        armTimeout(ctx);
         return;
     }
-    
-    // 如果启用了性能监控，记录请求结束
-    if (performanceMonitoringEnabled_) {
-        PerformanceMonitor::getInstance().endRequest(requestId, requestSuccess);
+    if (ctx.readPaused)
+    {
+        ctx.readPaused = false;
+        conn->startRead();
+    }
+    processInput(conn, ctx);
+}
+
+HttpResponse::HttpStatusCode HttpServer::handleCachedRequest(const Router::Route *route, HttpRequest &request,
+                                                             HttpContext &ctx, bool keepAlive, std::string *output)
+{
+    const std::string &key = ResponseCache::makeKey(request, *route->cache);
+    ResponseCache::EntryPtr entry = responseCache_->get(key);
+
+    if (!entry)
+    {
+        HttpResponse response(&ctx.loopState->arena);
+        router_.dispatch(route, request, &response);
+        if (response.statusCode() != HttpResponse::k200Ok)
+        {
+            // 只缓存 200 响应，其他状态照常发送
+            return writeResponse(request, keepAlive, &response, output);
+        }
+        entry = responseCache_->put(key, response, *route->cache, compression_.get());
+    }
+
+    std::string_view connection = responseHeaders(request, keepAlive);
+    const PreparedResponse &prepared = selectVariant(entry->prepared, request);
+    if (ResponseCache::matchesEtag(request.getHeader(HttpHeader::kIfNoneMatch), entry->etag))
+    {
+        // 客户端的副本仍然有效，不调用处理函数也不发送响应体。
+        // 304 带的是这次请求会收到的那个版本的 ETag 和 Vary
+        prepared.appendNotModified(output, connection);
+        return HttpResponse::k304NotModified;
+    }
+    prepared.appendTo(output, connection, request.method() == HttpRequest::kHead);
+    return prepared.statusCode();
+}
+
+HttpResponse::HttpStatusCode HttpServer::handleFileRequest(const Router::Route *route, HttpRequest &request,
+                                                           HttpContext &ctx, bool keepAlive, std::string *output)
+{
+    HttpResponse response(&ctx.loopState->arena);
+    if (!route->files->serve(request, request.getParam("filepath"), ctx.loopState->fileCache,
+                             compression_.get(), &response, &ctx.fileBody))
+    {
+        // 路径非法或文件不存在，交给默认处理函数
+        router_.dispatch(nullptr, request, &response);
+    }
+    return writeResponse(request, keepAlive, &response, output);
+}
+
+HttpResponse::HttpStatusCode HttpServer::writeResponse(const HttpRequest &request, bool keepAlive,
+                                                       HttpResponse *response, std::string *output)
+{
+    if (!keepAlive)
+    {
+        response->addHeader("Connection", "close");
+    }
+    else if (request.version() == "HTTP/1.0")
+    {
+        response->addHeader("Connection", "keep-alive");
+    }
+    if (requestIdHeader_)
+    {
+        char id[RequestContext::kIdLength];
+        RequestContext::formatId(request.requestId(), id);
+        response->addHeader("X-Request-Id", std::string_view(id, sizeof id));
+    }
+
+    if (compression_)
+    {
+        Compression::apply(request, response, *compression_);
+    }
+
+    // HEAD 请求只发送头部
+    response->setSuppressBody(request.method() == HttpRequest::kHead);
+
+    LOG_DEBUG("Request %016llx: response %d", static_cast<unsigned long long>(request.requestId()),
+              static_cast<int>(response->statusCode()));
+    response->appendToBuffer(output);
+    return response->statusCode();
+}
+
+void HttpServer::addRateLimit(std::string pathPrefix, RateLimitPolicy policy)
+{
+    // 按平均速率恢复一个令牌所需的时间作为 Retry-After
+    int retryAfter = policy.rate > 0 ? static_cast<int>(std::ceil(1.0 / policy.rate)) : 60;
+    HttpResponse response;
+    response.setStatusCode(HttpResponse::k429TooManyRequests);
+    response.setContentType("text/plain");
+    response.addHeader("Retry-After", std::to_string(retryAfter));
+    response.setBody("429 Too Many Requests");
+
+    RateLimitRule rule{std::move(pathPrefix), std::move(policy), std::make_shared<PreparedResponse>(response)};
+    auto it = std::find_if(rateLimits_.begin(), rateLimits_.end(), [&rule](const RateLimitRule &other)
+                           { return other.prefix.size() < rule.prefix.size(); });
+    rateLimits_.insert(it, std::move(rule));
+}
+
+bool HttpServer::checkRateLimit(const HttpRequest &request, HttpContext &ctx, bool keepAlive, std::string *output)
+{
+    std::string_view path = request.path();
+    for (size_t i = 0; i < rateLimits_.size(); ++i)
+    {
+        // 按路径段匹配：前缀以 '/' 结尾，或者路径在前缀之后正好结束或接着 '/'，
+        // "/upload" 匹配 "/upload" 和 "/upload/a"，不匹配 "/uploads"
+        const RateLimitRule &rule = rateLimits_[i];
+        const std::string &prefix = rule.prefix;
+        if (path.compare(0, prefix.size(), prefix) != 0 ||
+            (path.size() > prefix.size() && !prefix.empty() && prefix.back() != '/' && path[prefix.size()] != '/'))
+        {
+            continue;
+        }
+
+        // 不同规则的桶互不影响：规则序号参与键的计算
+        uint64_t seed = i + 1;
+        uint64_t key = ctx.peerKey ^ (seed * 0x9e3779b97f4a7c15ULL);
+        if (rule.policy.key == RateLimitPolicy::kHeader)
+        {
+            std::string_view value = request.getHeader(rule.policy.header);
+            if (!value.empty())
+            {
+                key = RateLimiter::hash(value, seed);
+            }
+        }
+
+        if (ctx.loopState->rateLimiter.allow(key, rule.policy, ctx.request.parsedNs))
+        {
+            return true;
+        }
+        rateLimitedRequests_.fetch_add(1, std::memory_order_relaxed);
+        rule.rejected->appendTo(output, responseHeaders(request, keepAlive),
+                                request.method() == HttpRequest::kHead);
+        ctx.request.status = rule.rejected->statusCode();
+        return false;
+    }
+    return true;
+}
+
+PreparedResponsePtr HttpServer::makeOverloadResponse(int retryAfter)
+{
+    HttpResponse response;
+    response.setStatusCode(HttpResponse::k503ServiceUnavailable);
+    response.setContentType("text/plain");
+    response.addHeader("Retry-After", std::to_string(retryAfter));
+    response.setBody("503 Service Unavailable");
+    return std::make_shared<PreparedResponse>(response);
+}
+
+bool HttpServer::admitInflight()
+{
+    if (maxInflightRequests_ <= 0)
+    {
+        return true;
+    }
+    if (inflightRequests_.fetch_add(1, std::memory_order_relaxed) >= maxInflightRequests_)
+    {
+        inflightRequests_.fetch_sub(1, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+void HttpServer::releaseInflight()
+{
+    if (maxInflightRequests_ > 0)
+    {
+        inflightRequests_.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+void HttpServer::onHighWaterMark(const TcpConnectionPtr &conn, size_t bytes)
+{
+    // 对端读得太慢：停止读取新请求，输出缓冲区发送完后在写完成回调中恢复
+    HttpContext &ctx = *conn->getContext<HttpContextPtr>();
+    LOG_DEBUG("Output high-water mark reached on %s: %zu bytes", ctx.peer.c_str(), bytes);
+    ctx.outputBlocked = true;
+    if (!ctx.readPaused)
+    {
+        ctx.readPaused = true;
+        conn->stopRead();
     }
+    conn->setWriteCompleteCallback(std::bind(&HttpServer::onWriteComplete, this, std::placeholders::_1));
+}
+
+const PreparedResponse &HttpServer::selectVariant(const PreparedResponse &prepared, const HttpRequest &request)
+{
+    if (!prepared.hasVariants())
+    {
+        return prepared;
+    }
+    return prepared.variant(Compression::negotiate(request.getHeader(HttpHeader::kAcceptEncoding)));
+}
+
+std::string_view HttpServer::connectionHeader(const HttpRequest &request, bool keepAlive)
+{
+    if (!keepAlive)
+    {
+        return "Connection: close\r\n";
+    }
+    if (request.version() == "HTTP/1.0")
+    {
+        return "Connection: keep-alive\r\n";
+    }
+    return std::string_view();
+}
+
+std::string_view HttpServer::responseHeaders(const HttpRequest &request, bool keepAlive) const
+{
+    std::string_view connection = connectionHeader(request, keepAlive);
+    if (!requestIdHeader_)
+    {
+        return connection;
+    }
+
+    // 只在当前 IO 线程内、下一次调用之前有效
+    static thread_local std::string headers;
+    char id[RequestContext::kIdLength];
+    RequestContext::formatId(request.requestId(), id);
+    headers.assign(connection.data(), connection.size());
+    headers.append("X-Request-Id: ", 14);
+    headers.append(id, sizeof id);
+    headers.append("\r\n", 2);
+    return headers;
 }
 
 // 添加性能监控相关方法的实现
@@ -166,24 +1197,3 @@ std::string HttpServer::getPerformanceReport() {
 void HttpServer::resetPerformanceStatistics() {
     PerformanceMonitor::getInstance().resetStatistics();
 }
-
-// 删除这个函数，因为它已经在 HttpServer.h 中定义了
-// std::string HttpServer::generateRequestId() {
-//     static std::random_device rd;
-//     static std::mt19937 gen(rd());
-//     static std::uniform_int_distribution<> dis(0, 15);
-//     static const char* digits = "0123456789abcdef";
-//     
-//     std::string uuid;
-//     uuid.reserve(36);
-//
-//     for (int i = 0; i < 36; i++) {
-//         if (i == 8 || i == 13 || i == 18 || i == 23) {
-//             uuid += '-';
-//         } else {
-//             uuid += digits[dis(gen)];
-//         }
-//     }
-//     
-//     return uuid;
-// }
\ No newline at end of file
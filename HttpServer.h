@@ -3,36 +3,64 @@
 
 #include "cc_muduo/TcpServer.h"
 #include "cc_muduo/EventLoop.h"
+#include "cc_muduo/EventLoopThread.h"
 #include "cc_muduo/InetAddress.h"
 #include "cc_muduo/TcpConnection.h"
+#include "AccessLog.h"
+#include "Compression.h"
 #include "HttpRequest.h"
 #include "HttpResponse.h"
+#include "HttpContext.h"
+#include "PreparedResponse.h"
+#include "RateLimiter.h"
+#include "ResponseCache.h"
 #include "Router.h"
+#include "TimerWheel.h"
+#include "WorkStealingPool.h"
 
+#include <atomic>
 #include <functional>
 #include <string>
 #include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
 
 // 在文件顶部添加包含
 #include "PerformanceMonitor.h"
-#include <random>
 
 class HttpServer
 {
 public:
     using RequestHandler = std::function<void(const HttpRequest &, HttpResponse *)>;
 
+    // 接受连接的方式
+    enum AcceptMode
+    {
+        kSingleAcceptor, // 主线程的一个监听套接字接受连接，轮流分给各 IO 线程
+        kReusePort       // 每个 IO 线程各有一个 SO_REUSEPORT 监听套接字，由内核分配新连接
+    };
+
     // 构造函数，指定监听地址和端口
     HttpServer(EventLoop *loop, const InetAddress &listenAddr,
-               const std::string &name = "HttpServer");
+               const std::string &name = "HttpServer", AcceptMode mode = kSingleAcceptor);
+    ~HttpServer();
 
-    // 设置线程数
+    // 设置 IO 线程数。kReusePort 模式下 loop 所在的线程也作为 IO 线程之一，
+    // 另外再创建 numThreads - 1 个线程
     void setThreadNum(int numThreads)
     {
-        server_.setThreadNum(numThreads);
+        if (acceptMode_ == kReusePort)
+        {
+            numThreads_ = numThreads;
+        }
+        else
+        {
+            server_.setThreadNum(numThreads);
+        }
     }
 
-    // 设置请求处理函数
+    // 设置请求处理函数，替代默认的路由分发
     void setRequestHandler(RequestHandler handler)
     {
         requestHandler_ = std::move(handler);
@@ -68,10 +96,238 @@ public:
         router_.del(path, std::move(handler));
     }
 
+    // 添加异步路由：处理函数在工作线程池中执行，适合耗时的 CPU 或阻塞操作，
+    // 不会拖慢同一 IO 线程上的其他连接
+    void addAsyncRoute(const std::string &method, const std::string &path, Router::AsyncHandlerCallback handler)
+    {
+        router_.addAsyncRoute(HttpRequest::stringToMethod(method), path, std::move(handler));
+        hasAsyncRoutes_ = true;
+    }
+
+    void getAsync(const std::string &path, Router::AsyncHandlerCallback handler)
+    {
+        addAsyncRoute("GET", path, std::move(handler));
+    }
+
+    void postAsync(const std::string &path, Router::AsyncHandlerCallback handler)
+    {
+        addAsyncRoute("POST", path, std::move(handler));
+    }
+
+    // 添加协程路由：处理函数返回 Task<HttpResponse>，在 IO 线程上运行，
+    // 等待定时器、文件读取、上游请求或线程池任务时不阻塞 EventLoop
+    void addCoroutineRoute(const std::string &method, const std::string &path,
+                           Router::CoroutineHandlerCallback handler)
+    {
+        router_.addCoroutineRoute(HttpRequest::stringToMethod(method), path, std::move(handler));
+        hasAsyncRoutes_ = true;
+    }
+
+    void getCoroutine(const std::string &path, Router::CoroutineHandlerCallback handler)
+    {
+        addCoroutineRoute("GET", path, std::move(handler));
+    }
+
+    void postCoroutine(const std::string &path, Router::CoroutineHandlerCallback handler)
+    {
+        addCoroutineRoute("POST", path, std::move(handler));
+    }
+
+    // 添加流式上传路由：请求头到达后调用 handler 创建 BodyStream，请求体（包括 chunked 编码的）
+    // 边到达边交给它，不在内存中整体缓存，大小受 Limits::maxStreamBodySize 限制
+    void addStreamRoute(const std::string &method, const std::string &path, Router::BodyStreamHandler handler)
+    {
+        router_.addStreamRoute(HttpRequest::stringToMethod(method), path, std::move(handler));
+        hasStreamRoutes_ = true;
+    }
+
+    void postStream(const std::string &path, Router::BodyStreamHandler handler)
+    {
+        addStreamRoute("POST", path, std::move(handler));
+    }
+
+    void putStream(const std::string &path, Router::BodyStreamHandler handler)
+    {
+        addStreamRoute("PUT", path, std::move(handler));
+    }
+
+    // 异步路由和静态文件压缩使用的工作线程数，默认为 CPU 核数；
+    // 0 表示直接在 IO 线程中执行异步处理函数、生成静态文件的压缩版本
+    void setWorkerThreadNum(int numThreads)
+    {
+        workerThreads_ = numThreads;
+    }
+
+    // 注册固定内容的 GET 路由：响应在 start 时序列化一次（此时压缩设置已经确定），
+    // 请求到来时直接拷贝共享的字节，不调用处理函数也不构造 HttpResponse
+    void getStatic(const std::string &path, const HttpResponse &response)
+    {
+        if (started_)
+        {
+            router_.addStatic(HttpRequest::kGet, path, std::make_shared<PreparedResponse>(response, compression_.get()));
+            return;
+        }
+        staticResponses_.emplace_back(path, response);
+    }
+
+    // 按 Accept-Encoding 压缩可压缩的响应。固定内容的路由和响应缓存中的响应只压缩一次，
+    // 保存各编码的版本；静态文件的压缩版本在工作线程中生成后随文件缓存，生成之前和过大的文件发送时流式压缩。
+    // 需在 start 之前调用
+    void enableCompression(CompressionPolicy policy = CompressionPolicy())
+    {
+        compression_ = std::make_unique<CompressionPolicy>(std::move(policy));
+    }
+
+    // 启用响应缓存，memoryBudget 为缓存可用的总字节数
+    void enableResponseCache(size_t memoryBudget)
+    {
+        responseCache_ = std::make_unique<ResponseCache>(memoryBudget);
+    }
+
+    // 注册可缓存的 GET 路由：200 响应缓存 ttlSeconds 秒，varyHeaders 中的请求头参与缓存键。
+    // 未启用响应缓存时与 get 相同
+    void getCached(const std::string &path, int ttlSeconds, Router::HandlerCallback handler,
+                   std::vector<std::string> varyHeaders = {})
+    {
+        auto policy = std::make_shared<CachePolicy>();
+        policy->ttlSeconds = ttlSeconds;
+        policy->varyHeaders = std::move(varyHeaders);
+        router_.addRoute(HttpRequest::kGet, path, std::move(handler)).cache = std::move(policy);
+    }
+
+    // 把 urlPrefix 下的 GET/HEAD 请求映射到 rootDir 目录中的文件，
+    // 支持 Range、If-Modified-Since，文件内容分块读取发送
+    void serveStatic(std::string urlPrefix, const std::string &rootDir)
+    {
+        while (!urlPrefix.empty() && urlPrefix.back() == '/')
+        {
+            urlPrefix.pop_back();
+        }
+        router_.addRoute(HttpRequest::kGet, urlPrefix + "/*filepath", nullptr).files =
+            std::make_shared<StaticDirectory>(rootDir);
+        hasStaticFiles_ = true;
+    }
+
+    // 是否支持长连接，关闭后每个响应发送完就断开
+    void setKeepAlive(bool on)
+    {
+        keepAlive_ = on;
+    }
+
+    // 每个连接最多处理的请求数，0 表示不限制
+    void setMaxRequestsPerConnection(int maxRequests)
+    {
+        maxRequestsPerConnection_ = maxRequests;
+    }
+
+    // 连接空闲、读取头部、读取请求体的超时时间（秒），0 表示不限制。
+    // 头部和请求体的超时从该阶段开始时计算，期间收到数据不会重新计时
+    void setIdleTimeout(int seconds)
+    {
+        idleTimeout_ = seconds;
+    }
+
+    void setHeaderTimeout(int seconds)
+    {
+        headerTimeout_ = seconds;
+    }
+
+    void setBodyTimeout(int seconds)
+    {
+        bodyTimeout_ = seconds;
+    }
+
+    // 请求行、头部和请求体的大小上限，需在 start 之前设置
+    void setRequestLimits(const HttpRequestParser::Limits &limits)
+    {
+        requestLimits_ = limits;
+    }
+
+    const HttpRequestParser::Limits &requestLimits() const { return requestLimits_; }
+
+    // 过载保护，0 表示不限制，需在 start 之前设置。
+    // 连接数超过 maxConnections 时新连接收到 503 后被关闭
+    void setMaxConnections(int maxConnections)
+    {
+        maxConnections_ = maxConnections;
+    }
+
+    // 连接的输出缓冲区超过 bytes 时停止读取该连接，发送完毕后恢复；
+    // 一次可读事件产生的流水线响应超过 bytes 时也暂停处理后续请求
+    void setOutputHighWaterMark(size_t bytes)
+    {
+        outputHighWaterMark_ = bytes;
+    }
+
+    // 同时在处理中的异步和协程请求数上限，超过时直接回复 503
+    void setMaxInflightRequests(int maxInflight)
+    {
+        maxInflightRequests_ = maxInflight;
+    }
+
+    // 503 响应中 Retry-After 的秒数
+    void setRetryAfter(int seconds)
+    {
+        retryAfter_ = seconds;
+    }
+
+    // 因过载被拒绝的连接数和请求数
+    uint64_t rejectedConnections() const { return rejectedConnections_.load(std::memory_order_relaxed); }
+    uint64_t shedRequests() const { return shedRequests_.load(std::memory_order_relaxed); }
+
+    // 对路径等于 pathPrefix 或位于其下（"/upload" 包括 "/upload/a"，不包括 "/uploads"）的请求
+    // 按令牌桶限流，超出时回复 429。多条规则匹配时使用前缀最长的一条，"/" 对所有请求生效。
+    // 限流在路由之前进行，桶在每个 IO 线程中各自维护，需在 start 之前调用
+    void addRateLimit(std::string pathPrefix, RateLimitPolicy policy);
+
+    // 每个 IO 线程最多保存的令牌桶数，超过时淘汰最近不活跃的客户端
+    void setRateLimitCapacity(size_t buckets)
+    {
+        rateLimitCapacity_ = buckets;
+    }
+
+    // 被限流拒绝的请求数
+    uint64_t rateLimitedRequests() const { return rateLimitedRequests_.load(std::memory_order_relaxed); }
+
+    // 在每个响应中附带 X-Request-Id 头部，值与 HttpRequest::requestId() 相同，便于与日志关联
+    void setRequestIdHeader(bool on)
+    {
+        requestIdHeader_ = on;
+    }
+
+    // 记录访问日志到 path，sampleRate 为 N 时每 N 个请求记录一个（错误响应总是记录）。
+    // 需在 start 之前调用
+    void enableAccessLog(const std::string &path, AccessLog::Format format = AccessLog::kCombined,
+                         int sampleRate = 1)
+    {
+        accessLog_ = std::make_unique<AccessLog>(path, format, sampleRate);
+    }
+
+    const AccessLog *accessLog() const { return accessLog_.get(); }
+
     // 启动服务器
     void start()
     {
+        // 静态文件的压缩版本也在工作线程中生成，不阻塞 IO 线程
+        bool needsWorkers = hasAsyncRoutes_ || (compression_ && hasStaticFiles_);
+        if (needsWorkers && workerThreads_ != 0 && !workerPool_)
+        {
+            size_t numThreads = workerThreads_ > 0 ? static_cast<size_t>(workerThreads_)
+                                                   : std::thread::hardware_concurrency();
+            workerPool_ = std::make_unique<WorkStealingPool>(numThreads);
+        }
+        overloadResponse_ = makeOverloadResponse(retryAfter_);
+        for (const auto &[path, response] : staticResponses_)
+        {
+            router_.addStatic(HttpRequest::kGet, path, std::make_shared<PreparedResponse>(response, compression_.get()));
+        }
+        staticResponses_.clear();
+        started_ = true;
         server_.start();
+        if (acceptMode_ == kReusePort)
+        {
+            startListeners();
+        }
     }
     
     std::function<void(const HttpRequest &, HttpResponse *)> getRequestHandler()
@@ -87,34 +343,163 @@ public:
 
 private:
     TcpServer server_;
+    InetAddress listenAddr_;
+    std::string name_;
+    AcceptMode acceptMode_;
+    int numThreads_ = 0;
+    // kReusePort 模式下其余 IO 线程及其各自的监听 TcpServer
+    std::vector<std::unique_ptr<EventLoopThread>> listenerThreads_;
+    std::vector<std::unique_ptr<TcpServer>> listeners_;
     
     Router router_;
     std::function<void(const HttpRequest &, HttpResponse *)> requestHandler_;
     // 处理新连接
     void onConnection(const std::shared_ptr<TcpConnection> &conn);
     void onMessage(const std::shared_ptr<TcpConnection> &conn, Buffer *buf, Timestamp receiveTime);
+    // 处理一个完整的请求，把序列化后的响应追加到 output，状态码记录到 ctx.request，
+    // 返回请求是否被成功处理
+    bool handleRequest(const TcpConnectionPtr &conn, HttpRequest &request, HttpContext &ctx,
+                       std::string *output);
+
+    // 记录一个新请求，返回响应之后是否保持连接
+    bool startRequest(const HttpRequest &request, HttpContext &ctx);
+
+    // 按匹配到的路由计入性能监控，route 为空表示没有匹配
+    void recordRoute(const Router::Route *route);
+
+    // 请求头已解析完、请求体还没到达：流式路由在这里创建 BodyStream 并返回 true，其他路由返回 false
+    bool startBodyStream(const TcpConnectionPtr &conn, HttpContext &ctx, std::string *output);
+
+    // 把缓冲区中已到达的请求体交给 BodyStream，请求结束（响应已写入 output）时返回 true
+    bool processBodyStream(const TcpConnectionPtr &conn, HttpContext &ctx, std::string *output);
+
+    // 流式请求结束：记录访问日志和性能统计，准备接收下一个请求
+    void finishBodyStream(HttpContext &ctx, bool success, uint64_t bytes);
+
+    // BodyStream::resume 投递到 IO 线程执行
+    void resumeBodyStream(const std::weak_ptr<TcpConnection> &weakConn, uint64_t requestId);
+
+    // 解析失败时回复错误并关闭连接
+    void appendErrorResponse(HttpContext &ctx, HttpResponse::HttpStatusCode status, std::string *output);
+
+    // 把请求拷贝出输入缓冲区，创建在 IO 线程中发送响应的完成对象
+    ResponseCompletionPtr makeCompletion(const TcpConnectionPtr &conn, HttpRequest &request,
+                                         HttpContext &ctx, bool keepAlive);
+
+    // 交给工作线程池执行异步处理函数
+    void dispatchAsync(const TcpConnectionPtr &conn, const Router::Route *route,
+                       HttpRequest &request, HttpContext &ctx, bool keepAlive);
+
+    // 启动协程处理函数
+    void dispatchCoroutine(const TcpConnectionPtr &conn, const Router::Route *route,
+                           HttpRequest &request, HttpContext &ctx, bool keepAlive);
+
+    // 在 IO 线程中发送异步处理函数序列化好的响应，并继续处理后续的流水线请求
+    void onAsyncComplete(const std::weak_ptr<TcpConnection> &weakConn, const DetachedRequestPtr &request,
+                         const std::string &output, HttpResponse::HttpStatusCode status);
+
+    // 通过响应缓存处理请求，未命中时调用路由并尝试缓存结果
+    HttpResponse::HttpStatusCode handleCachedRequest(const Router::Route *route, HttpRequest &request,
+                                                     HttpContext &ctx, bool keepAlive, std::string *output);
+
+    // 补上 Connection 头部并序列化动态生成的响应
+    HttpResponse::HttpStatusCode writeResponse(const HttpRequest &request, bool keepAlive,
+                                               HttpResponse *response, std::string *output);
+
+    // 静态文件路由：响应头写入 output，文件内容记录到连接上随后分块发送
+    HttpResponse::HttpStatusCode handleFileRequest(const Router::Route *route, HttpRequest &request,
+                                                   HttpContext &ctx, bool keepAlive, std::string *output);
+
+    // 按请求的 Accept-Encoding 选择预先序列化的响应的压缩版本
+    static const PreparedResponse &selectVariant(const PreparedResponse &prepared, const HttpRequest &request);
+
+    // 过载时的 503 响应，启动时序列化一次
+    static PreparedResponsePtr makeOverloadResponse(int retryAfter);
+
+    // 限流阶段，请求被拒绝时写入 429 并返回 false
+    bool checkRateLimit(const HttpRequest &request, HttpContext &ctx, bool keepAlive, std::string *output);
+
+    // 占用一个处理中请求的名额，超过上限时返回 false；releaseInflight 归还
+    bool admitInflight();
+    void releaseInflight();
+
+    // 输出缓冲区超过高水位
+    void onHighWaterMark(const TcpConnectionPtr &conn, size_t bytes);
+
+    // 按长连接决策返回需要附加的 Connection 头部行
+    static std::string_view connectionHeader(const HttpRequest &request, bool keepAlive);
+
+    // 预先序列化的响应需要附加的头部行：Connection 以及可选的 X-Request-Id
+    std::string_view responseHeaders(const HttpRequest &request, bool keepAlive) const;
+
+    // kReusePort 模式：为其余 IO 线程各创建一个监听同一端口的 TcpServer
+    void startListeners();
+
+    void onThreadInit(EventLoop *loop);
+    HttpLoopState *loopState(EventLoop *loop);
+
+    // 循环处理输入缓冲区中的完整请求并一次性发送响应
+    void processInput(const TcpConnectionPtr &conn, HttpContext &ctx);
+
+    // 文件响应体分块发送：每块写完后在写完成回调中发送下一块
+    void onWriteComplete(const TcpConnectionPtr &conn);
+    void sendFileChunk(const TcpConnectionPtr &conn, HttpContext &ctx);
+    void abortTruncatedFile(const TcpConnectionPtr &conn, HttpContext &ctx);
+
+    // 解析错误对应的状态码
+    static HttpResponse::HttpStatusCode parseErrorStatus(HttpRequestParser::HttpRequestParseResult result);
+
+    // 按解析器当前所处的阶段重新设置连接的超时
+    void armTimeout(HttpContext &ctx);
+
+    std::unique_ptr<ResponseCache> responseCache_;
+    std::unique_ptr<AccessLog> accessLog_;
+    std::unique_ptr<CompressionPolicy> compression_; // 为空时不压缩
+    std::vector<std::pair<std::string, HttpResponse>> staticResponses_; // getStatic 注册、等待 start 序列化的响应
+    bool started_ = false;
+
+    std::unique_ptr<WorkStealingPool> workerPool_;
+    int workerThreads_ = -1;
+    bool hasAsyncRoutes_ = false;
+    bool hasStaticFiles_ = false;
+    bool hasStreamRoutes_ = false; // 有流式路由时解析器在请求体之前停下，由路由决定接收方式
+
+    std::mutex loopStatesMutex_;
+    std::unordered_map<EventLoop *, std::unique_ptr<HttpLoopState>> loopStates_;
+
+    // 连接管理参数
+    bool keepAlive_ = true;
+    int maxRequestsPerConnection_ = 0;
+    int idleTimeout_ = 60;
+    int headerTimeout_ = 10;
+    int bodyTimeout_ = 30;
+    HttpRequestParser::Limits requestLimits_;
     
     // 添加性能监控标志
     bool performanceMonitoringEnabled_ = false;
-    
-    // 生成唯一的请求ID
-    std::string generateRequestId() {
-        static std::random_device rd;
-        static std::mt19937 gen(rd());
-        static std::uniform_int_distribution<> dis(0, 15);
-        static const char* digits = "0123456789abcdef";
-        
-        std::string uuid;
-        uuid.reserve(36);
-
-        for (int i = 0; i < 36; i++) {
-            if (i == 8 || i == 13 || i == 18 || i == 23) {
-                uuid += '-';
-            } else {
-                uuid += digits[dis(gen)];
-            }
-        }
-        
-        return uuid;
-    }
+
+    // 是否在响应中附带 X-Request-Id 头部
+    bool requestIdHeader_ = false;
+
+    // 过载保护
+    int maxConnections_ = 0;
+    size_t outputHighWaterMark_ = 0;
+    int maxInflightRequests_ = 0;
+    int retryAfter_ = 1;
+    PreparedResponsePtr overloadResponse_;
+    std::atomic<int> connectionCount_{0};
+    std::atomic<int> inflightRequests_{0};
+    std::atomic<uint64_t> rejectedConnections_{0};
+    std::atomic<uint64_t> shedRequests_{0};
+
+    // 限流规则，按前缀长度从长到短排列，拒绝响应在添加规则时序列化
+    struct RateLimitRule
+    {
+        std::string prefix;
+        RateLimitPolicy policy;
+        PreparedResponsePtr rejected;
+    };
+    std::vector<RateLimitRule> rateLimits_;
+    size_t rateLimitCapacity_ = 64 * 1024;
+    std::atomic<uint64_t> rateLimitedRequests_{0};
 };
@@ -0,0 +1,267 @@
+// HttpTokenizer.cpp
+#include "HttpTokenizer.h"
+
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CC_TOKENIZER_X86 1
+#include <immintrin.h>
+#endif
+
+namespace
+{
+    using Scan = const char *(*)(const char *, const char *);
+
+    struct CharTable
+    {
+        bool allowed[256] = {};
+    };
+
+    constexpr bool isTokenChar(unsigned c)
+    {
+        if ((c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'))
+        {
+            return true;
+        }
+        for (const char *s = "!#$%&'*+-.^_`|~"; *s != '\0'; ++s)
+        {
+            if (c == static_cast<unsigned char>(*s))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    constexpr bool isTargetChar(unsigned c) { return c > 0x20 && c != 0x7f; }
+
+    constexpr bool isFieldValueChar(unsigned c) { return (c >= 0x20 || c == '\t') && c != 0x7f; }
+
+    constexpr CharTable makeTable(bool (*pred)(unsigned))
+    {
+        CharTable table;
+        for (unsigned c = 0; c < 256; ++c)
+        {
+            table.allowed[c] = pred(c);
+        }
+        return table;
+    }
+
+    constexpr CharTable kTokenTable = makeTable(isTokenChar);
+    constexpr CharTable kTargetTable = makeTable(isTargetChar);
+    constexpr CharTable kFieldValueTable = makeTable(isFieldValueChar);
+
+    inline const char *scanScalar(const CharTable &table, const char *p, const char *end)
+    {
+        while (p != end && table.allowed[static_cast<unsigned char>(*p)])
+        {
+            ++p;
+        }
+        return p;
+    }
+
+    const char *tokenScalar(const char *p, const char *end) { return scanScalar(kTokenTable, p, end); }
+    const char *targetScalar(const char *p, const char *end) { return scanScalar(kTargetTable, p, end); }
+    const char *fieldValueScalar(const char *p, const char *end) { return scanScalar(kFieldValueTable, p, end); }
+
+#ifdef CC_TOKENIZER_X86
+    // SSE4.2：PCMPESTRI 按字节区间匹配，区间表列出不允许的字符，最多 8 个区间。
+    // token 的区间表把 '|' 和 '~' 也算进了 "{" 到 0xff，命中后再查表确认
+    alignas(16) constexpr char kTokenRanges[16] = {
+        '\x00', ' ', '"', '"', '(', ')', ',', ',', '/', '/', ':', '@', '[', ']', '{', '\xff'};
+    alignas(16) constexpr char kTargetRanges[16] = {'\x00', ' ', '\x7f', '\x7f'};
+    alignas(16) constexpr char kFieldValueRanges[16] = {'\x00', '\x08', '\x0a', '\x1f', '\x7f', '\x7f'};
+
+    __attribute__((target("sse4.2"))) inline const char *scanSse42(const CharTable &table, const char *ranges,
+                                                                  int rangesLength, const char *p, const char *end)
+    {
+        const __m128i set = _mm_load_si128(reinterpret_cast<const __m128i *>(ranges));
+        while (end - p >= 16)
+        {
+            __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+            int index = _mm_cmpestri(set, rangesLength, bytes, 16,
+                                     _SIDD_UBYTE_OPS | _SIDD_CMP_RANGES | _SIDD_LEAST_SIGNIFICANT);
+            if (index == 16)
+            {
+                p += 16;
+                continue;
+            }
+            p += index;
+            if (!table.allowed[static_cast<unsigned char>(*p)])
+            {
+                return p;
+            }
+            ++p;
+        }
+        return scanScalar(table, p, end);
+    }
+
+    __attribute__((target("sse4.2"))) const char *tokenSse42(const char *p, const char *end)
+    {
+        return scanSse42(kTokenTable, kTokenRanges, 16, p, end);
+    }
+
+    __attribute__((target("sse4.2"))) const char *targetSse42(const char *p, const char *end)
+    {
+        return scanSse42(kTargetTable, kTargetRanges, 4, p, end);
+    }
+
+    __attribute__((target("sse4.2"))) const char *fieldValueSse42(const char *p, const char *end)
+    {
+        return scanSse42(kFieldValueTable, kFieldValueRanges, 6, p, end);
+    }
+
+    // AVX2：token 用高低半字节两次 PSHUFB 查位图，精确判断每个字节；
+    // 目标和头部值只需要比较控制字符。不足 32 字节的尾部交给 SSE4.2 版本
+    struct NibbleTable
+    {
+        alignas(16) uint8_t low[16] = {};
+        alignas(16) uint8_t high[16] = {};
+    };
+
+    // 字节 c 允许当且仅当 low[c & 0xf] & high[c >> 4] 不为 0，0x80 以上的字节 high 为 0
+    constexpr NibbleTable makeNibbleTable(const CharTable &table)
+    {
+        NibbleTable nibbles;
+        for (unsigned c = 0; c < 128; ++c)
+        {
+            if (table.allowed[c])
+            {
+                nibbles.low[c & 0xf] |= static_cast<uint8_t>(1u << (c >> 4));
+            }
+        }
+        for (unsigned h = 0; h < 8; ++h)
+        {
+            nibbles.high[h] = static_cast<uint8_t>(1u << h);
+        }
+        return nibbles;
+    }
+
+    constexpr NibbleTable kTokenNibbles = makeNibbleTable(kTokenTable);
+
+    __attribute__((target("avx2"))) inline uint32_t tokenRejectMask(__m256i bytes)
+    {
+        const __m256i low = _mm256_broadcastsi128_si256(
+            _mm_load_si128(reinterpret_cast<const __m128i *>(kTokenNibbles.low)));
+        const __m256i high = _mm256_broadcastsi128_si256(
+            _mm_load_si128(reinterpret_cast<const __m128i *>(kTokenNibbles.high)));
+        const __m256i nibbleMask = _mm256_set1_epi8(0x0f);
+        __m256i lowBits = _mm256_shuffle_epi8(low, _mm256_and_si256(bytes, nibbleMask));
+        __m256i highBits = _mm256_shuffle_epi8(high, _mm256_and_si256(_mm256_srli_epi16(bytes, 4), nibbleMask));
+        __m256i allowed = _mm256_and_si256(lowBits, highBits);
+        return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(allowed, _mm256_setzero_si256())));
+    }
+
+    __attribute__((target("avx2"))) inline uint32_t targetRejectMask(__m256i bytes)
+    {
+        const __m256i space = _mm256_set1_epi8(0x20);
+        __m256i control = _mm256_cmpeq_epi8(_mm256_max_epu8(bytes, space), space);
+        __m256i del = _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(0x7f));
+        return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_or_si256(control, del)));
+    }
+
+    __attribute__((target("avx2"))) inline uint32_t fieldValueRejectMask(__m256i bytes)
+    {
+        const __m256i unitSeparator = _mm256_set1_epi8(0x1f);
+        __m256i control = _mm256_cmpeq_epi8(_mm256_max_epu8(bytes, unitSeparator), unitSeparator);
+        __m256i tab = _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\t'));
+        __m256i del = _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(0x7f));
+        return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_or_si256(_mm256_andnot_si256(tab, control), del)));
+    }
+
+    template <uint32_t (*RejectMask)(__m256i), Scan Tail>
+    __attribute__((target("avx2"))) const char *scanAvx2(const char *p, const char *end)
+    {
+        while (end - p >= 32)
+        {
+            uint32_t mask = RejectMask(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)));
+            if (mask != 0)
+            {
+                return p + __builtin_ctz(mask);
+            }
+            p += 32;
+        }
+        return Tail(p, end);
+    }
+#endif
+
+    struct Implementation
+    {
+        Scan token;
+        Scan target;
+        Scan fieldValue;
+    };
+
+    constexpr Implementation kImplementations[] = {
+        {tokenScalar, targetScalar, fieldValueScalar},
+#ifdef CC_TOKENIZER_X86
+        {tokenSse42, targetSse42, fieldValueSse42},
+        {scanAvx2<tokenRejectMask, tokenSse42>,
+         scanAvx2<targetRejectMask, targetSse42>,
+         scanAvx2<fieldValueRejectMask, fieldValueSse42>},
+#else
+        {tokenScalar, targetScalar, fieldValueScalar},
+        {tokenScalar, targetScalar, fieldValueScalar},
+#endif
+    };
+
+    HttpTokenizer::Level g_level = HttpTokenizer::detect();
+    const Implementation *g_implementation = &kImplementations[g_level];
+}
+
+const char *HttpTokenizer::skipToken(const char *p, const char *end)
+{
+    return g_implementation->token(p, end);
+}
+
+const char *HttpTokenizer::skipTarget(const char *p, const char *end)
+{
+    return g_implementation->target(p, end);
+}
+
+const char *HttpTokenizer::skipFieldValue(const char *p, const char *end)
+{
+    return g_implementation->fieldValue(p, end);
+}
+
+HttpTokenizer::Level HttpTokenizer::level()
+{
+    return g_level;
+}
+
+const char *HttpTokenizer::levelName(Level level)
+{
+    switch (level)
+    {
+    case kAvx2:
+        return "avx2";
+    case kSse42:
+        return "sse4.2";
+    default:
+        return "scalar";
+    }
+}
+
+HttpTokenizer::Level HttpTokenizer::detect()
+{
+#ifdef CC_TOKENIZER_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return kAvx2;
+    }
+    if (__builtin_cpu_supports("sse4.2"))
+    {
+        return kSse42;
+    }
+#endif
+    return kScalar;
+}
+
+HttpTokenizer::Level HttpTokenizer::setLevel(Level level)
+{
+    Level supported = detect();
+    g_level = level > supported ? supported : level;
+    g_implementation = &kImplementations[g_level];
+    return g_level;
+}
@@ -0,0 +1,36 @@
+// HttpTokenizer.h
+#pragma once
+
+// 请求行和头部的字符扫描：一次检查 16 或 32 个字节，找到第一个不属于指定字符集的字节。
+// 启动时按 CPU 支持的指令集选择 AVX2、SSE4.2 或逐字节查表的实现。
+// 所有函数都只读取 [p, end) 范围内的字节
+class HttpTokenizer
+{
+public:
+    enum Level
+    {
+        kScalar,
+        kSse42,
+        kAvx2
+    };
+
+    // 方法名和头部名使用的 token 字符（RFC 7230 tchar），返回第一个非 token 字节，全部是时返回 end
+    static const char *skipToken(const char *p, const char *end);
+
+    // 请求目标：可见字符和 0x80 以上的字节，遇到空格或控制字符停止
+    static const char *skipTarget(const char *p, const char *end);
+
+    // 头部值：可见字符、空格、制表符和 0x80 以上的字节，遇到其它控制字符（包括 \r、\n）停止
+    static const char *skipFieldValue(const char *p, const char *end);
+
+    // 当前使用的实现
+    static Level level();
+    static const char *levelName(Level level);
+
+    // CPU 支持的最高级别
+    static Level detect();
+
+    // 切换实现，超过 CPU 支持的级别时降到 detect()，返回实际使用的级别。
+    // 只应在启动阶段或基准测试中调用，不与解析并发
+    static Level setLevel(Level level);
+};
@@ -0,0 +1,133 @@
+// LatencyHistogram.h
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// 固定大小的对数-线性直方图（HDR 风格），记录纳秒级延迟。
+// 每个 2 的幂区间再均分为 32 个子桶，相对误差约 3%，最大可记录 2^64 ns
+class LatencyHistogram
+{
+public:
+    static constexpr int kSubBucketBits = 5;
+    static constexpr uint64_t kSubBuckets = 1 << kSubBucketBits;
+    static constexpr size_t kBucketCount = (64 - kSubBucketBits + 1) * kSubBuckets;
+
+    LatencyHistogram() { reset(); }
+
+    static size_t bucketIndex(uint64_t value)
+    {
+        if (value < kSubBuckets)
+        {
+            return static_cast<size_t>(value);
+        }
+        int exponent = 63 - __builtin_clzll(value);
+        int shift = exponent - kSubBucketBits;
+        size_t group = static_cast<size_t>(shift + 1);
+        size_t sub = static_cast<size_t>((value >> shift) - kSubBuckets);
+        return group * kSubBuckets + sub;
+    }
+
+    // 桶内数值的下界
+    static uint64_t bucketLowerBound(size_t index)
+    {
+        size_t group = index / kSubBuckets;
+        uint64_t sub = index % kSubBuckets;
+        if (group == 0)
+        {
+            return sub;
+        }
+        return (kSubBuckets + sub) << (group - 1);
+    }
+
+    // 桶内数值的中点，用作分位数的报告值
+    static uint64_t bucketMidpoint(size_t index)
+    {
+        size_t group = index / kSubBuckets;
+        if (group <= 1)
+        {
+            return bucketLowerBound(index);
+        }
+        return bucketLowerBound(index) + (uint64_t(1) << (group - 2));
+    }
+
+    void record(uint64_t value)
+    {
+        ++counts_[bucketIndex(value)];
+        ++count_;
+        sum_ += value;
+        min_ = std::min(min_, value);
+        max_ = std::max(max_, value);
+    }
+
+    // 按桶累加，用于合并其他线程的分片
+    void addBucket(size_t index, uint64_t count)
+    {
+        if (count == 0)
+        {
+            return;
+        }
+        counts_[index] += count;
+        count_ += count;
+        sum_ += bucketMidpoint(index) * count;
+        min_ = std::min(min_, bucketLowerBound(index));
+        max_ = std::max(max_, bucketMidpoint(index));
+    }
+
+    void merge(const LatencyHistogram &other)
+    {
+        for (size_t i = 0; i < kBucketCount; ++i)
+        {
+            counts_[i] += other.counts_[i];
+        }
+        count_ += other.count_;
+        sum_ += other.sum_;
+        min_ = std::min(min_, other.min_);
+        max_ = std::max(max_, other.max_);
+    }
+
+    // percentile 取值 0~100
+    uint64_t percentile(double percentile) const
+    {
+        if (count_ == 0)
+        {
+            return 0;
+        }
+        uint64_t target = static_cast<uint64_t>(percentile / 100.0 * static_cast<double>(count_) + 0.5);
+        target = std::max<uint64_t>(1, std::min(target, count_));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < kBucketCount; ++i)
+        {
+            seen += counts_[i];
+            if (seen >= target)
+            {
+                return std::min(bucketMidpoint(i), max_);
+            }
+        }
+        return max_;
+    }
+
+    uint64_t count() const { return count_; }
+    uint64_t min() const { return count_ > 0 ? min_ : 0; }
+    uint64_t max() const { return max_; }
+    double mean() const { return count_ > 0 ? static_cast<double>(sum_) / static_cast<double>(count_) : 0.0; }
+    uint64_t bucket(size_t index) const { return counts_[index]; }
+
+    void reset()
+    {
+        counts_.fill(0);
+        count_ = 0;
+        sum_ = 0;
+        min_ = UINT64_MAX;
+        max_ = 0;
+    }
+
+private:
+    std::array<uint64_t, kBucketCount> counts_;
+    uint64_t count_;
+    uint64_t sum_;
+    uint64_t min_;
+    uint64_t max_;
+};
@@ -0,0 +1,347 @@
+// Logger.cpp
+#include "Logger.h"
+
+#include "cc_muduo/CurrentThread.h"
+
+#include <chrono>
+#include <cstdarg>
+#include <cstring>
+#include <time.h>
+
+namespace
+{
+    const char *kLevelNames[Logger::kLevelCount] = {"TRACE", "DEBUG", "INFO ", "WARN ", "ERROR"};
+
+    // 每个线程积压的日志块上限，超过后丢弃新日志，避免磁盘过慢时内存无限增长
+    const size_t kMaxPendingChunks = 64;
+
+    // 每个线程保留的空块数
+    const size_t kMaxSpareChunks = 2;
+
+    const char *baseName(const char *path)
+    {
+        const char *slash = strrchr(path, '/');
+        return slash != nullptr ? slash + 1 : path;
+    }
+}
+
+LogFile::LogFile(std::string basename, size_t rollSize, int maxFiles)
+    : basename_(std::move(basename)), rollSize_(rollSize), maxFiles_(maxFiles), fp_(nullptr), written_(0)
+{
+    open();
+}
+
+LogFile::~LogFile()
+{
+    if (fp_ != nullptr)
+    {
+        fclose(fp_);
+    }
+}
+
+void LogFile::append(const char *data, size_t len)
+{
+    if (fp_ == nullptr)
+    {
+        // 日志文件无法打开时退回到标准错误
+        fwrite(data, 1, len, stderr);
+        return;
+    }
+    fwrite(data, 1, len, fp_);
+    written_ += len;
+    if (written_ >= rollSize_)
+    {
+        roll();
+    }
+}
+
+void LogFile::flush()
+{
+    if (fp_ != nullptr)
+    {
+        fflush(fp_);
+    }
+}
+
+void LogFile::open()
+{
+    fp_ = fopen((basename_ + ".log").c_str(), "ae");
+    written_ = 0;
+    if (fp_ != nullptr)
+    {
+        fseek(fp_, 0, SEEK_END);
+        long size = ftell(fp_);
+        written_ = size > 0 ? static_cast<size_t>(size) : 0;
+    }
+}
+
+void LogFile::roll()
+{
+    fclose(fp_);
+    fp_ = nullptr;
+
+    std::string current = basename_ + ".log";
+    if (maxFiles_ <= 0)
+    {
+        ::remove(current.c_str());
+    }
+    else
+    {
+        // basename.log.N-1 -> basename.log.N ... basename.log -> basename.log.1，最旧的被覆盖
+        for (int i = maxFiles_ - 1; i >= 1; --i)
+        {
+            std::string from = current + "." + std::to_string(i);
+            std::string to = current + "." + std::to_string(i + 1);
+            ::rename(from.c_str(), to.c_str());
+        }
+        ::rename(current.c_str(), (current + ".1").c_str());
+    }
+    open();
+}
+
+Logger &Logger::instance()
+{
+    static Logger logger;
+    return logger;
+}
+
+Logger::Logger()
+    : level_(kInfo),
+      flushIntervalMs_(1000),
+      dropped_(0),
+      wakeup_(false),
+      running_(true)
+{
+    writer_ = std::thread(&Logger::writerLoop, this);
+}
+
+Logger::~Logger()
+{
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex_);
+        running_ = false;
+    }
+    wakeCond_.notify_one();
+    writer_.join();
+}
+
+void Logger::setOutputFile(const std::string &basename, size_t rollSize, int maxFiles)
+{
+    std::lock_guard<std::mutex> lock(sinkMutex_);
+    drain();
+    file_ = std::make_unique<LogFile>(basename, rollSize, maxFiles);
+}
+
+void Logger::flush()
+{
+    std::lock_guard<std::mutex> lock(sinkMutex_);
+    drain();
+}
+
+void Logger::log(Level level, const char *file, int line, const char *fmt, ...)
+{
+    // 行首的时间精确到微秒，秒以上的部分每秒只格式化一次
+    thread_local time_t lastSecond = 0;
+    thread_local char timeBuf[32];
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    if (now.tv_sec != lastSecond)
+    {
+        lastSecond = now.tv_sec;
+        struct tm tm;
+        localtime_r(&lastSecond, &tm);
+        strftime(timeBuf, sizeof timeBuf, "%Y%m%d %H:%M:%S", &tm);
+    }
+
+    ThreadBuffer &buffer = localBuffer();
+    bool chunkFilled = false;
+
+    va_list args;
+    va_start(args, fmt);
+    {
+        std::lock_guard<std::mutex> lock(buffer.mutex);
+        for (;;)
+        {
+            Chunk &chunk = *buffer.current;
+            char *p = chunk.data + chunk.len;
+            size_t avail = chunk.avail();
+
+            int head = snprintf(p, avail, "%s.%06ld %d %s %s:%d - ", timeBuf, now.tv_nsec / 1000,
+                                CurrentThread::tid(), kLevelNames[level], baseName(file), line);
+            int body = -1;
+            if (head >= 0 && static_cast<size_t>(head) < avail)
+            {
+                va_list copy;
+                va_copy(copy, args);
+                body = vsnprintf(p + head, avail - head, fmt, copy);
+                va_end(copy);
+            }
+
+            // 留出换行符的位置
+            if (body >= 0 && static_cast<size_t>(head + body) < avail)
+            {
+                p[head + body] = '\n';
+                chunk.len += head + body + 1;
+                break;
+            }
+
+            if (chunk.len == 0)
+            {
+                // 单条日志比整块还大，截断
+                chunk.data[Chunk::kSize - 1] = '\n';
+                chunk.len = Chunk::kSize;
+                break;
+            }
+
+            // 当前块放不下，换一块重新格式化
+            if (buffer.full.size() >= kMaxPendingChunks)
+            {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                break;
+            }
+            buffer.full.push_back(std::move(buffer.current));
+            buffer.current = takeSpare(buffer);
+            chunkFilled = true;
+        }
+    }
+    va_end(args);
+
+    if (chunkFilled)
+    {
+        {
+            std::lock_guard<std::mutex> lock(wakeMutex_);
+            wakeup_ = true;
+        }
+        wakeCond_.notify_one();
+    }
+}
+
+Logger::ThreadBuffer &Logger::localBuffer()
+{
+    thread_local ThreadBuffer *buffer = nullptr;
+    if (buffer == nullptr)
+    {
+        auto owned = std::make_unique<ThreadBuffer>();
+        owned->current = std::make_unique<Chunk>();
+        buffer = owned.get();
+        std::lock_guard<std::mutex> lock(buffersMutex_);
+        buffers_.push_back(std::move(owned));
+    }
+    return *buffer;
+}
+
+Logger::ChunkPtr Logger::takeSpare(ThreadBuffer &buffer)
+{
+    if (buffer.spare.empty())
+    {
+        return std::make_unique<Chunk>();
+    }
+    ChunkPtr chunk = std::move(buffer.spare.back());
+    buffer.spare.pop_back();
+    return chunk;
+}
+
+void Logger::writerLoop()
+{
+    for (;;)
+    {
+        bool stop;
+        {
+            std::unique_lock<std::mutex> lock(wakeMutex_);
+            wakeCond_.wait_for(lock, std::chrono::milliseconds(flushIntervalMs_),
+                               [this]()
+                               { return wakeup_ || !running_; });
+            wakeup_ = false;
+            stop = !running_;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(sinkMutex_);
+            drain();
+        }
+
+        if (stop)
+        {
+            break;
+        }
+    }
+}
+
+bool Logger::drain()
+{
+    // 线程缓冲区只增不减，拷贝指针后就可以释放注册表的锁
+    std::vector<ThreadBuffer *> buffers;
+    {
+        std::lock_guard<std::mutex> lock(buffersMutex_);
+        buffers.reserve(buffers_.size());
+        for (const auto &buffer : buffers_)
+        {
+            buffers.push_back(buffer.get());
+        }
+    }
+
+    bool wrote = false;
+    for (ThreadBuffer *buffer : buffers)
+    {
+        // 换下写满的块和正在写的块，持锁时间只有几次指针交换
+        {
+            std::lock_guard<std::mutex> lock(buffer->mutex);
+            for (auto &chunk : buffer->full)
+            {
+                writing_.push_back(std::move(chunk));
+            }
+            buffer->full.clear();
+            if (buffer->current->len > 0)
+            {
+                writing_.push_back(std::move(buffer->current));
+                buffer->current = takeSpare(*buffer);
+            }
+        }
+
+        if (writing_.empty())
+        {
+            continue;
+        }
+
+        for (const auto &chunk : writing_)
+        {
+            if (file_)
+            {
+                file_->append(chunk->data, chunk->len);
+            }
+            else
+            {
+                fwrite(chunk->data, 1, chunk->len, stdout);
+            }
+        }
+        wrote = true;
+
+        // 写完的块还给原线程复用
+        {
+            std::lock_guard<std::mutex> lock(buffer->mutex);
+            for (auto &chunk : writing_)
+            {
+                if (buffer->spare.size() >= kMaxSpareChunks)
+                {
+                    break;
+                }
+                chunk->len = 0;
+                buffer->spare.push_back(std::move(chunk));
+            }
+        }
+        writing_.clear();
+    }
+
+    if (wrote)
+    {
+        if (file_)
+        {
+            file_->flush();
+        }
+        else
+        {
+            fflush(stdout);
+        }
+    }
+    return wrote;
+}
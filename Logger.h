@@ -0,0 +1,145 @@
+// Logger.h
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 编译期保留的最低日志级别，低于它的日志语句连同参数求值一起被编译器删除。
+// 0 TRACE, 1 DEBUG, 2 INFO, 3 WARN, 4 ERROR
+#ifndef CC_LOG_MIN_LEVEL
+#define CC_LOG_MIN_LEVEL 1
+#endif
+
+// 按大小滚动的日志文件：当前文件为 basename.log，写满后依次改名为 basename.log.1 ... .N
+class LogFile
+{
+public:
+    LogFile(std::string basename, size_t rollSize, int maxFiles);
+    ~LogFile();
+
+    void append(const char *data, size_t len);
+    void flush();
+
+private:
+    void open();
+    void roll();
+
+    std::string basename_;
+    size_t rollSize_;
+    int maxFiles_;
+    FILE *fp_;
+    size_t written_;
+};
+
+// 异步日志：每个线程把格式化好的日志追加到自己的缓冲区，后台线程定期或在缓冲区写满时
+// 把各线程的缓冲区换下来统一写出。线程缓冲区的锁只会和后台线程竞争
+class Logger
+{
+public:
+    enum Level
+    {
+        kTrace,
+        kDebug,
+        kInfo,
+        kWarn,
+        kError,
+        kLevelCount
+    };
+
+    static Logger &instance();
+
+    void setLevel(Level level) { level_.store(level, std::memory_order_relaxed); }
+    Level level() const { return level_.load(std::memory_order_relaxed); }
+    bool enabled(Level level) const { return level >= this->level(); }
+
+    // 输出到文件，rollSize 为单个文件的最大字节数；未设置时输出到标准输出
+    void setOutputFile(const std::string &basename, size_t rollSize = 64 * 1024 * 1024, int maxFiles = 5);
+
+    // 后台线程的最长刷新间隔
+    void setFlushInterval(int milliseconds) { flushIntervalMs_ = milliseconds; }
+
+    // 写出所有线程已提交的日志后返回
+    void flush();
+
+    // 因后台写出过慢、积压超过上限而丢弃的日志条数
+    uint64_t droppedCount() const { return dropped_.load(std::memory_order_relaxed); }
+
+    void log(Level level, const char *file, int line, const char *fmt, ...)
+        __attribute__((format(printf, 5, 6)));
+
+    ~Logger();
+
+private:
+    // 固定大小的日志块
+    struct Chunk
+    {
+        static constexpr size_t kSize = 64 * 1024;
+
+        size_t avail() const { return kSize - len; }
+
+        char data[kSize];
+        size_t len = 0;
+    };
+
+    using ChunkPtr = std::unique_ptr<Chunk>;
+
+    struct ThreadBuffer
+    {
+        std::mutex mutex;
+        ChunkPtr current;
+        std::vector<ChunkPtr> full;  // 已写满等待写出的块
+        std::vector<ChunkPtr> spare; // 写出后回收的空块
+    };
+
+    Logger();
+    Logger(const Logger &) = delete;
+    Logger &operator=(const Logger &) = delete;
+
+    ThreadBuffer &localBuffer();
+    ChunkPtr takeSpare(ThreadBuffer &buffer);
+    void writerLoop();
+    // 收集所有线程的日志块并写出，返回是否写出了内容
+    bool drain();
+
+    std::atomic<Level> level_;
+    int flushIntervalMs_;
+    std::atomic<uint64_t> dropped_;
+
+    std::mutex buffersMutex_;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers_;
+
+    // 后台线程的唤醒条件
+    std::mutex wakeMutex_;
+    std::condition_variable wakeCond_;
+    bool wakeup_;
+    bool running_;
+
+    // 只由后台线程或持有 sinkMutex_ 时访问
+    std::mutex sinkMutex_;
+    std::unique_ptr<LogFile> file_;
+    std::vector<ChunkPtr> writing_;
+
+    std::thread writer_;
+};
+
+#define LOG_AT(level, ...)                                                        \
+    do                                                                            \
+    {                                                                             \
+        if (Logger::level >= CC_LOG_MIN_LEVEL && Logger::instance().enabled(Logger::level)) \
+        {                                                                         \
+            Logger::instance().log(Logger::level, __FILE__, __LINE__, __VA_ARGS__); \
+        }                                                                         \
+    } while (0)
+
+#define LOG_TRACE(...) LOG_AT(kTrace, __VA_ARGS__)
+#define LOG_DEBUG(...) LOG_AT(kDebug, __VA_ARGS__)
+#define LOG_INFO(...) LOG_AT(kInfo, __VA_ARGS__)
+#define LOG_WARN(...) LOG_AT(kWarn, __VA_ARGS__)
+#define LOG_ERROR(...) LOG_AT(kError, __VA_ARGS__)
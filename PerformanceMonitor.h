@@ -1,66 +1,61 @@
 #pragma once
 
+#include "LatencyHistogram.h"
+#include "Logger.h"
+
+#include <algorithm>
+#include <array>
 #include <chrono>
+#include <cstdio>
+#include <memory>
 #include <mutex>
 #include <string>
-#include <unordered_map>
+#include <string_view>
 #include <vector>
 #include <atomic>
-#include <iostream>
 #include <fstream>
 #include <thread>
 #include <functional>
 
 class PerformanceMonitor {
 public:
+    // 按路由统计请求数的固定槽位：0 给没有匹配任何路由的请求（404 等），
+    // 最后一个给超出槽位数的路由，内存不随客户端请求的路径增长
+    static constexpr size_t kPathSlots = 256;
+    static constexpr int kUnmatchedPath = 0;
+    static constexpr int kOtherPaths = static_cast<int>(kPathSlots) - 1;
+
     static PerformanceMonitor& getInstance() {
         static PerformanceMonitor instance;
         return instance;
     }
 
-    // 开始记录请求处理时间
-    void startRequest(const std::string& requestId) {
-        std::lock_guard<std::mutex> lock(mutex_);
-        requestStartTimes_[requestId] = std::chrono::high_resolution_clock::now();
-    }
+    // 记录一次请求的处理耗时（纳秒），只写当前线程的分片
+    void recordRequest(int64_t latencyNs, bool success = true) {
+        Shard &shard = localShard();
+        uint64_t latency = latencyNs > 0 ? static_cast<uint64_t>(latencyNs) : 0;
 
-    // 结束记录请求处理时间
-    void endRequest(const std::string& requestId, bool success = true) {
-        auto endTime = std::chrono::high_resolution_clock::now();
-        
-        std::lock_guard<std::mutex> lock(mutex_);
-        auto it = requestStartTimes_.find(requestId);
-        if (it != requestStartTimes_.end()) {
-            auto startTime = it->second;
-            auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime).count();
-            
-            totalRequests_++;
-            if (success) {
-                successfulRequests_++;
-            }
-            
-            totalProcessingTime_ += duration;
-            
-            // 更新最大和最小处理时间
-            if (duration > maxProcessingTime_) {
-                maxProcessingTime_ = duration;
-            }
-            if (minProcessingTime_ == 0 || duration < minProcessingTime_) {
-                minProcessingTime_ = duration;
-            }
-            
-            // 记录处理时间以计算平均值和中位数
-            processingTimes_.push_back(duration);
-            
-            requestStartTimes_.erase(it);
+        shard.totalRequests.fetch_add(1, std::memory_order_relaxed);
+        if (success) {
+            shard.successfulRequests.fetch_add(1, std::memory_order_relaxed);
+        }
+        shard.totalNs.fetch_add(latency, std::memory_order_relaxed);
+        shard.buckets[LatencyHistogram::bucketIndex(latency)].fetch_add(1, std::memory_order_relaxed);
+
+        // 只有所属线程会增大 / 减小这两个值，无需 CAS
+        if (latency > shard.maxNs.load(std::memory_order_relaxed)) {
+            shard.maxNs.store(latency, std::memory_order_relaxed);
+        }
+        if (latency < shard.minNs.load(std::memory_order_relaxed)) {
+            shard.minNs.store(latency, std::memory_order_relaxed);
         }
     }
 
     // 增加当前连接数
     void incrementConnections() {
-        currentConnections_++;
-        if (currentConnections_ > peakConnections_) {
-            peakConnections_ = currentConnections_.load();
+        int current = ++currentConnections_;
+        int peak = peakConnections_.load(std::memory_order_relaxed);
+        while (current > peak && !peakConnections_.compare_exchange_weak(peak, current)) {
         }
     }
 
@@ -69,49 +64,100 @@ public:
         currentConnections_--;
     }
 
-    // 记录请求的路径统计
-    void recordPath(const std::string& path) {
-        std::lock_guard<std::mutex> lock(mutex_);
-        pathCounts_[path]++;
+    // 为路由模式（如 "GET /users/:id"）分配统计槽位，注册路由时调用一次，同名模式共用一个槽位
+    int registerPath(std::string_view pattern) {
+        std::lock_guard<std::mutex> lock(pathNamesMutex_);
+        for (size_t i = 1; i < pathNames_.size(); ++i) {
+            if (pathNames_[i] == pattern) {
+                return static_cast<int>(i);
+            }
+        }
+        if (pathNames_.size() >= static_cast<size_t>(kOtherPaths)) {
+            return kOtherPaths;
+        }
+        pathNames_.emplace_back(pattern);
+        return static_cast<int>(pathNames_.size() - 1);
     }
 
-    // 获取性能统计报告
+    // 记录一次请求匹配到的路由，slot 来自 registerPath 或 kUnmatchedPath。
+    // 只增加当前线程分片中的计数，不加锁也不分配内存
+    void recordPath(int slot) {
+        localShard().pathCounts[static_cast<size_t>(slot)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // 获取性能统计报告，合并所有线程的分片
     std::string getStatisticsReport() {
-        std::lock_guard<std::mutex> lock(mutex_);
-        
+        uint64_t totalRequests = 0;
+        uint64_t successfulRequests = 0;
+        uint64_t totalNs = 0;
+        uint64_t minNs = UINT64_MAX;
+        uint64_t maxNs = 0;
+        LatencyHistogram histogram;
+        std::array<uint64_t, kPathSlots> pathCounts{};
+
+        {
+            std::lock_guard<std::mutex> lock(shardsMutex_);
+            for (const auto &shard : shards_) {
+                totalRequests += shard->totalRequests.load(std::memory_order_relaxed);
+                successfulRequests += shard->successfulRequests.load(std::memory_order_relaxed);
+                totalNs += shard->totalNs.load(std::memory_order_relaxed);
+                minNs = std::min(minNs, shard->minNs.load(std::memory_order_relaxed));
+                maxNs = std::max(maxNs, shard->maxNs.load(std::memory_order_relaxed));
+                for (size_t i = 0; i < LatencyHistogram::kBucketCount; ++i) {
+                    histogram.addBucket(i, shard->buckets[i].load(std::memory_order_relaxed));
+                }
+                for (size_t i = 0; i < kPathSlots; ++i) {
+                    pathCounts[i] += shard->pathCounts[i].load(std::memory_order_relaxed);
+                }
+            }
+        }
+
         std::string report = "===== 服务器性能统计 =====\n";
-        
+
         // 基本统计信息
-        report += "总请求数: " + std::to_string(totalRequests_) + "\n";
-        report += "成功请求数: " + std::to_string(successfulRequests_) + "\n";
-        
-        double successRate = totalRequests_ > 0 ? 
-            (double)successfulRequests_ / totalRequests_ * 100.0 : 0.0;
+        report += "总请求数: " + std::to_string(totalRequests) + "\n";
+        report += "成功请求数: " + std::to_string(successfulRequests) + "\n";
+
+        double successRate = totalRequests > 0 ?
+            (double)successfulRequests / totalRequests * 100.0 : 0.0;
         report += "请求成功率: " + std::to_string(successRate) + "%\n";
-        
+
         // 连接统计
         report += "当前连接数: " + std::to_string(currentConnections_) + "\n";
         report += "峰值连接数: " + std::to_string(peakConnections_) + "\n";
-        
+
         // 处理时间统计
-        double avgProcessingTime = totalRequests_ > 0 ? 
-            (double)totalProcessingTime_ / totalRequests_ : 0.0;
-        report += "平均处理时间: " + std::to_string(avgProcessingTime) + " ms\n";
-        report += "最大处理时间: " + std::to_string(maxProcessingTime_) + " ms\n";
-        report += "最小处理时间: " + std::to_string(minProcessingTime_) + " ms\n";
-        
-        // 路径统计（前5个最常访问的路径）
-        report += "\n最常访问的路径:\n";
-        std::vector<std::pair<std::string, int>> pathStats(pathCounts_.begin(), pathCounts_.end());
-        std::sort(pathStats.begin(), pathStats.end(), 
+        double avgNs = totalRequests > 0 ? (double)totalNs / totalRequests : 0.0;
+        report += "平均处理时间: " + formatMs(avgNs) + "\n";
+        report += "最大处理时间: " + formatMs((double)maxNs) + "\n";
+        report += "最小处理时间: " + formatMs(totalRequests > 0 ? (double)minNs : 0.0) + "\n";
+        report += "P50 处理时间: " + formatMs((double)histogram.percentile(50.0)) + "\n";
+        report += "P90 处理时间: " + formatMs((double)histogram.percentile(90.0)) + "\n";
+        report += "P99 处理时间: " + formatMs((double)histogram.percentile(99.0)) + "\n";
+        report += "P99.9 处理时间: " + formatMs((double)histogram.percentile(99.9)) + "\n";
+
+        // 路由统计（前5个最常访问的路由）
+        report += "\n最常访问的路由:\n";
+        std::vector<std::pair<std::string, uint64_t>> pathStats;
+        {
+            std::lock_guard<std::mutex> lock(pathNamesMutex_);
+            for (size_t i = 0; i < kPathSlots; ++i) {
+                if (pathCounts[i] == 0) {
+                    continue;
+                }
+                const char *other = "(其他路由)";
+                pathStats.emplace_back(i < pathNames_.size() ? pathNames_[i] : other, pathCounts[i]);
+            }
+        }
+        std::sort(pathStats.begin(), pathStats.end(),
                  [](const auto& a, const auto& b) { return a.second > b.second; });
-        
+
         int count = 0;
         for (const auto& path : pathStats) {
             report += path.first + ": " + std::to_string(path.second) + " 次\n";
             if (++count >= 5) break;
         }
-        
+
         return report;
     }
 
@@ -136,7 +182,7 @@ public:
             while (!stopReporting_) {
                 std::this_thread::sleep_for(std::chrono::seconds(intervalSeconds));
                 if (!stopReporting_) {
-                    std::cout << getStatisticsReport() << std::endl;
+                    LOG_INFO("\n%s", getStatisticsReport().c_str());
                 }
             }
         });
@@ -150,16 +196,22 @@ public:
         }
     }
 
-    // 重置所有统计数据
+    // 重置所有统计数据。与 IO 线程并发执行时，正在记录的少量样本可能被部分清零
     void resetStatistics() {
-        std::lock_guard<std::mutex> lock(mutex_);
-        totalRequests_ = 0;
-        successfulRequests_ = 0;
-        totalProcessingTime_ = 0;
-        maxProcessingTime_ = 0;
-        minProcessingTime_ = 0;
-        processingTimes_.clear();
-        pathCounts_.clear();
+        std::lock_guard<std::mutex> lock(shardsMutex_);
+        for (const auto &shard : shards_) {
+            shard->totalRequests.store(0, std::memory_order_relaxed);
+            shard->successfulRequests.store(0, std::memory_order_relaxed);
+            shard->totalNs.store(0, std::memory_order_relaxed);
+            shard->minNs.store(UINT64_MAX, std::memory_order_relaxed);
+            shard->maxNs.store(0, std::memory_order_relaxed);
+            for (auto &bucket : shard->buckets) {
+                bucket.store(0, std::memory_order_relaxed);
+            }
+            for (auto &count : shard->pathCounts) {
+                count.store(0, std::memory_order_relaxed);
+            }
+        }
         // 不重置当前连接数，只重置峰值
         peakConnections_ = currentConnections_.load();
     }
@@ -169,34 +221,54 @@ public:
     }
 
 private:
-    PerformanceMonitor() : 
-        totalRequests_(0), 
-        successfulRequests_(0),
-        totalProcessingTime_(0),
-        maxProcessingTime_(0),
-        minProcessingTime_(0),
+    // 每个线程一个分片，独占缓存行；计数只由所属线程写入，报告线程只读
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> totalRequests{0};
+        std::atomic<uint64_t> successfulRequests{0};
+        std::atomic<uint64_t> totalNs{0};
+        std::atomic<uint64_t> minNs{UINT64_MAX};
+        std::atomic<uint64_t> maxNs{0};
+        std::array<std::atomic<uint64_t>, LatencyHistogram::kBucketCount> buckets{};
+
+        std::array<std::atomic<uint64_t>, kPathSlots> pathCounts{};
+    };
+
+    PerformanceMonitor() :
         currentConnections_(0),
         peakConnections_(0),
         stopReporting_(false) {}
-    
+
     // 禁止复制和赋值
     PerformanceMonitor(const PerformanceMonitor&) = delete;
     PerformanceMonitor& operator=(const PerformanceMonitor&) = delete;
 
-    std::mutex mutex_;
-    std::unordered_map<std::string, std::chrono::time_point<std::chrono::high_resolution_clock>> requestStartTimes_;
-    std::unordered_map<std::string, int> pathCounts_;
-    std::vector<long long> processingTimes_;
-    
-    long long totalRequests_;
-    long long successfulRequests_;
-    long long totalProcessingTime_;
-    long long maxProcessingTime_;
-    long long minProcessingTime_;
-    
+    // 线程第一次记录时注册分片，之后不再加全局锁。分片随单例一直存在，线程退出后数据仍计入报告
+    Shard &localShard() {
+        thread_local Shard *shard = nullptr;
+        if (shard == nullptr) {
+            auto owned = std::make_unique<Shard>();
+            shard = owned.get();
+            std::lock_guard<std::mutex> lock(shardsMutex_);
+            shards_.push_back(std::move(owned));
+        }
+        return *shard;
+    }
+
+    static std::string formatMs(double ns) {
+        char buf[32];
+        snprintf(buf, sizeof buf, "%.3f ms", ns / 1e6);
+        return buf;
+    }
+
+    std::mutex shardsMutex_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+
+    std::mutex pathNamesMutex_;
+    std::vector<std::string> pathNames_{"(未匹配的路由)"}; // 下标为槽位
+
     std::atomic<int> currentConnections_;
     std::atomic<int> peakConnections_;
-    
+
     std::thread reportingThread_;
     std::atomic<bool> stopReporting_;
-};
\ No newline at end of file
+};
@@ -0,0 +1,130 @@
+// PreparedResponse.h
+#pragma once
+
+#include "Compression.h"
+#include "HttpResponse.h"
+
+#include <array>
+#include <memory>
+#include <string>
+#include <string_view>
+
+// 启动时一次性序列化好的响应，所有连接共享同一份只读字节。
+// 保存的头部不含 Date 和结束空行，发送时补上缓存的 Date、按需的 Connection 头部和空行。
+// 给出压缩策略且响应可压缩时，同时准备好每种可用编码的压缩版本，请求到来时按 Accept-Encoding 选择
+class PreparedResponse
+{
+public:
+    explicit PreparedResponse(const HttpResponse &response, const CompressionPolicy *compression = nullptr)
+    {
+        if (compression == nullptr || !Compression::compressible(response, *compression))
+        {
+            prepare(response);
+            return;
+        }
+
+        HttpResponse identity(response);
+        Compression::addVary(&identity);
+        prepare(identity);
+        for (int i = Compression::kIdentity + 1; i < Compression::kEncodingCount; ++i)
+        {
+            Compression::Encoding encoding = static_cast<Compression::Encoding>(i);
+            HttpResponse encoded(identity);
+            if (Compression::available(encoding) && Compression::encode(encoding, &encoded, *compression))
+            {
+                variants_[i] = std::make_unique<const PreparedResponse>(encoded);
+            }
+        }
+    }
+
+    // 指定编码的版本，没有时返回未压缩的版本
+    const PreparedResponse &variant(Compression::Encoding encoding) const
+    {
+        return variants_[encoding] ? *variants_[encoding] : *this;
+    }
+
+    bool hasVariants() const
+    {
+        for (const auto &variant : variants_)
+        {
+            if (variant)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // extraHeaders 为完整的头部行（含 "\r\n"），headOnly 时不发送响应体
+    void appendTo(std::string *output, std::string_view extraHeaders, bool headOnly) const
+    {
+        output->append(head_);
+        output->append(extraHeaders.data(), extraHeaders.size());
+        std::string_view date = HttpResponse::dateHeader();
+        output->append(date.data(), date.size());
+        output->append("\r\n", 2);
+        if (!headOnly)
+        {
+            output->append(body_);
+        }
+    }
+
+    // 304：不带响应体，只带 200 响应中与校验和缓存有关的头部（ETag、Vary 等，RFC 9110 15.4.5），
+    // 压缩版本的 304 带它自己的弱 ETag 和 Vary
+    void appendNotModified(std::string *output, std::string_view extraHeaders) const
+    {
+        std::string_view line = HttpResponse::statusLine(HttpResponse::k304NotModified);
+        output->append(line.data(), line.size());
+        output->append(notModifiedHead_);
+        output->append(extraHeaders.data(), extraHeaders.size());
+        std::string_view date = HttpResponse::dateHeader();
+        output->append(date.data(), date.size());
+        output->append("\r\n", 2);
+    }
+
+    HttpResponse::HttpStatusCode statusCode() const { return status_; }
+    size_t bodySize() const { return body_.size(); }
+    // 包括所有压缩版本
+    size_t size() const
+    {
+        size_t total = head_.size() + body_.size();
+        for (const auto &variant : variants_)
+        {
+            if (variant)
+            {
+                total += variant->size();
+            }
+        }
+        return total;
+    }
+
+private:
+    void prepare(const HttpResponse &response)
+    {
+        status_ = response.statusCode();
+        body_.assign(response.body().data(), response.body().size());
+        response.appendHeaderLines(&head_);
+
+        static constexpr std::string_view kNotModifiedHeaders[] = {
+            "Cache-Control", "Content-Location", "ETag", "Expires", "Vary"};
+        for (std::string_view name : kNotModifiedHeaders)
+        {
+            std::string_view value = response.getHeader(name);
+            if (!value.empty())
+            {
+                notModifiedHead_.append(name.data(), name.size());
+                notModifiedHead_.append(": ", 2);
+                notModifiedHead_.append(value.data(), value.size());
+                notModifiedHead_.append("\r\n", 2);
+            }
+        }
+    }
+
+    HttpResponse::HttpStatusCode status_;
+    std::string head_;
+    std::string notModifiedHead_; // 304 带的头部行
+    std::string body_;
+    std::array<std::unique_ptr<const PreparedResponse>, Compression::kEncodingCount> variants_;
+};
+
+using PreparedResponsePtr = std::shared_ptr<const PreparedResponse>;
@@ -0,0 +1,161 @@
+// RateLimiter.h
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// 令牌桶限流策略：每秒补充 rate 个令牌，桶中最多 burst 个，每个请求消耗一个
+struct RateLimitPolicy
+{
+    enum Key
+    {
+        kPeerAddress, // 按对端 IP
+        kHeader       // 按请求头（例如 API Key），请求中没有该头部时按对端 IP
+    };
+
+    double rate = 10;
+    double burst = 20;
+    Key key = kPeerAddress;
+    std::string header; // key 为 kHeader 时使用的请求头
+};
+
+// 固定容量的令牌桶表，每个 IO 线程一个，只在所属线程访问，不需要加锁。
+// 表按 kWays 个槽位分组，键只落在一组之内；组满时用 CLOCK 算法淘汰最近没有访问过的桶，
+// 伪造源地址的洪泛只会在表内互相挤占，内存不会增长。
+// 只保存键的 64 位哈希，哈希冲突的两个客户端共用一个桶
+class RateLimiter
+{
+public:
+    static constexpr size_t kWays = 8;
+
+    RateLimiter() = default;
+
+    RateLimiter(const RateLimiter &) = delete;
+    RateLimiter &operator=(const RateLimiter &) = delete;
+
+    // 分配可容纳 capacity 个桶的表（向上取整为 kWays 乘以 2 的幂），清空已有的桶
+    void reset(size_t capacity)
+    {
+        size_t sets = 1;
+        while (sets * kWays < capacity)
+        {
+            sets <<= 1;
+        }
+        slots_.assign(sets * kWays, Slot());
+        hands_.assign(sets, 0);
+        setShift_ = 64;
+        for (size_t n = sets; n > 1; n >>= 1)
+        {
+            --setShift_;
+        }
+        size_ = 0;
+        evictions_ = 0;
+    }
+
+    // 为 key 对应的桶取一个令牌，桶空时返回 false。nowNs 为单调时钟的纳秒数
+    bool allow(uint64_t key, const RateLimitPolicy &policy, int64_t nowNs)
+    {
+        if (slots_.empty())
+        {
+            return true;
+        }
+        key = key != 0 ? key : 1; // 0 表示空槽
+        Slot *set = &slots_[setIndex(key) * kWays];
+
+        Slot *empty = nullptr;
+        for (size_t i = 0; i < kWays; ++i)
+        {
+            Slot &slot = set[i];
+            if (slot.key == key)
+            {
+                slot.referenced = true;
+                double elapsed = static_cast<double>(nowNs - slot.updatedNs) * 1e-9;
+                slot.tokens = std::min(policy.burst, slot.tokens + std::max(elapsed, 0.0) * policy.rate);
+                slot.updatedNs = nowNs;
+                if (slot.tokens < 1)
+                {
+                    return false;
+                }
+                slot.tokens -= 1;
+                return true;
+            }
+            if (slot.key == 0 && empty == nullptr)
+            {
+                empty = &slot;
+            }
+        }
+
+        if (empty != nullptr)
+        {
+            ++size_;
+        }
+        else
+        {
+            empty = evict(set, hands_[setIndex(key)]);
+            ++evictions_;
+        }
+        // 新客户端从满桶开始
+        empty->key = key;
+        empty->tokens = policy.burst - 1;
+        empty->updatedNs = nowNs;
+        empty->referenced = false;
+        return policy.burst >= 1;
+    }
+
+    // 64 位 FNV-1a，seed 用来区分不同策略的桶
+    static uint64_t hash(std::string_view text, uint64_t seed = 0)
+    {
+        uint64_t h = 1469598103934665603ULL ^ (seed * 0x9e3779b97f4a7c15ULL);
+        for (unsigned char c : text)
+        {
+            h ^= c;
+            h *= 1099511628211ULL;
+        }
+        return h;
+    }
+
+    // 已分配的槽位数、正在使用的桶数和被淘汰的桶数
+    size_t capacity() const { return slots_.size(); }
+    size_t size() const { return size_; }
+    uint64_t evictions() const { return evictions_; }
+
+private:
+    struct Slot
+    {
+        uint64_t key = 0;
+        double tokens = 0;
+        int64_t updatedNs = 0;
+        bool referenced = false; // CLOCK 的访问位
+    };
+
+    // 用高位选择分组，FNV 的低位分布较差
+    size_t setIndex(uint64_t key) const
+    {
+        return setShift_ < 64 ? static_cast<size_t>((key * 0x9e3779b97f4a7c15ULL) >> setShift_) : 0;
+    }
+
+    // 指针扫过组内的槽位，清除访问位，第一个访问位为 0 的桶被淘汰
+    static Slot *evict(Slot *set, uint8_t &hand)
+    {
+        for (;;)
+        {
+            Slot &slot = set[hand];
+            hand = static_cast<uint8_t>((hand + 1) % kWays);
+            if (!slot.referenced)
+            {
+                return &slot;
+            }
+            slot.referenced = false;
+        }
+    }
+
+    std::vector<Slot> slots_;
+    std::vector<uint8_t> hands_; // 每组的 CLOCK 指针
+    int setShift_ = 64;
+    size_t size_ = 0;
+    uint64_t evictions_ = 0;
+};
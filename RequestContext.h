@@ -0,0 +1,63 @@
+// RequestContext.h
+#pragma once
+
+#include "cc_muduo/Timestamp.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+// 单个请求的上下文，与连接的解析器状态保存在一起，每个新请求开始时重新初始化。
+// 各阶段时间使用单调时钟的纳秒数，便于计算耗时
+struct RequestContext
+{
+    // 请求 ID：高 16 位为 IO 线程序号，低 48 位为该线程内的递增计数，不需要任何同步
+    static constexpr int kSequenceBits = 48;
+
+    static uint64_t makeId(uint16_t threadIndex, uint64_t sequence)
+    {
+        return (static_cast<uint64_t>(threadIndex) << kSequenceBits) |
+               (sequence & ((uint64_t(1) << kSequenceBits) - 1));
+    }
+
+    // 以 16 位十六进制写入 buf，不含结尾的 '\0'
+    static constexpr size_t kIdLength = 16;
+    static void formatId(uint64_t id, char *buf)
+    {
+        static const char *digits = "0123456789abcdef";
+        for (int i = static_cast<int>(kIdLength) - 1; i >= 0; --i)
+        {
+            buf[i] = digits[id & 0xf];
+            id >>= 4;
+        }
+    }
+
+    static int64_t nowNs()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+    // 收到新请求的第一个字节时调用
+    void begin(uint64_t requestId, Timestamp received)
+    {
+        id = requestId;
+        receiveTime = received;
+        startNs = nowNs();
+        parsedNs = 0;
+        handledNs = 0;
+        status = 0;
+    }
+
+    int64_t parseNs() const { return parsedNs - startNs; }
+    int64_t handleNs() const { return handledNs - parsedNs; }
+    int64_t totalNs() const { return handledNs - startNs; }
+
+    uint64_t id = 0;
+    Timestamp receiveTime; // 请求首个字节所在可读事件的时间
+    int64_t startNs = 0;   // 开始接收请求
+    int64_t parsedNs = 0;  // 请求解析完成
+    int64_t handledNs = 0; // 响应已序列化到输出缓冲区
+    int status = 0;        // 响应状态码
+};
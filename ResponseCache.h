@@ -0,0 +1,221 @@
+// ResponseCache.h
+#pragma once
+
+#include "HttpRequest.h"
+#include "HttpResponse.h"
+#include "PreparedResponse.h"
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// 路由的缓存策略
+struct CachePolicy
+{
+    int ttlSeconds = 60;
+    std::vector<std::string> varyHeaders; // 参与缓存键的请求头
+};
+
+using CachePolicyPtr = std::shared_ptr<const CachePolicy>;
+
+// 分片 LRU 响应缓存，保存序列化好的 200 响应及其强 ETag。
+// 每个分片一把锁，IO 线程只在同一分片上竞争；总内存按分片平均分配
+class ResponseCache
+{
+public:
+    struct Entry
+    {
+        Entry(const HttpResponse &response, std::string tag, int64_t expire, const CompressionPolicy *compression)
+            : prepared(response, compression), etag(std::move(tag)), expireAt(expire)
+        {
+        }
+
+        PreparedResponse prepared;
+        std::string etag; // 未压缩版本的强 ETag，压缩版本的弱 ETag 与它只差 W/ 前缀
+        int64_t expireAt; // 过期时间（秒，单调时钟）
+    };
+
+    using EntryPtr = std::shared_ptr<const Entry>;
+
+    explicit ResponseCache(size_t memoryBudget, size_t shardCount = 16)
+        : shards_(shardCount), shardBudget_(memoryBudget / shardCount)
+    {
+    }
+
+    // 命中且未过期时返回缓存项
+    EntryPtr get(const std::string &key)
+    {
+        Shard &shard = shardFor(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.index.find(key);
+        if (it == shard.index.end())
+        {
+            return nullptr;
+        }
+        if (it->second->entry->expireAt <= nowSeconds())
+        {
+            erase(shard, it->second);
+            return nullptr;
+        }
+        // 移到 LRU 头部
+        shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+        return it->second->entry;
+    }
+
+    // 为响应生成 ETag 并存入缓存，返回新的缓存项。compression 非空时同时缓存压缩版本，
+    // 每个缓存项只压缩一次
+    EntryPtr put(const std::string &key, HttpResponse &response, const CachePolicy &policy,
+                 const CompressionPolicy *compression = nullptr)
+    {
+        std::string etag = makeEtag(response.body());
+        response.addHeader("ETag", etag);
+        if (!policy.varyHeaders.empty())
+        {
+            std::string vary;
+            for (const auto &name : policy.varyHeaders)
+            {
+                if (!vary.empty())
+                {
+                    vary += ", ";
+                }
+                vary += name;
+            }
+            response.addHeader("Vary", vary);
+        }
+        auto entry = std::make_shared<const Entry>(response, std::move(etag),
+                                                   nowSeconds() + policy.ttlSeconds, compression);
+        size_t bytes = key.size() + entry->prepared.size();
+
+        Shard &shard = shardFor(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        if (bytes > shardBudget_)
+        {
+            return entry;
+        }
+
+        auto it = shard.index.find(key);
+        if (it != shard.index.end())
+        {
+            erase(shard, it->second);
+        }
+        while (shard.bytes + bytes > shardBudget_ && !shard.lru.empty())
+        {
+            erase(shard, std::prev(shard.lru.end()));
+        }
+
+        shard.lru.push_front(Node{key, entry, bytes});
+        shard.index.emplace(key, shard.lru.begin());
+        shard.bytes += bytes;
+        return entry;
+    }
+
+    // 缓存键：方法、路径、查询串和策略指定的请求头，写入线程局部缓冲区避免分配。
+    // HEAD 与 GET 共用同一个缓存项
+    static const std::string &makeKey(const HttpRequest &request, const CachePolicy &policy)
+    {
+        thread_local std::string key;
+        key.clear();
+        key += request.method() == HttpRequest::kHead ? "GET" : HttpRequest::methodToString(request.method());
+        key += ' ';
+        key.append(request.path().data(), request.path().size());
+        key += '?';
+        key.append(request.query().data(), request.query().size());
+        for (const auto &name : policy.varyHeaders)
+        {
+            std::string_view value = request.getHeader(name);
+            key += '\n';
+            key.append(value.data(), value.size());
+        }
+        return key;
+    }
+
+    // If-None-Match 使用弱比较：忽略 W/ 前缀，支持 "*" 和逗号分隔的列表
+    static bool matchesEtag(std::string_view ifNoneMatch, std::string_view etag)
+    {
+        while (!ifNoneMatch.empty())
+        {
+            size_t comma = ifNoneMatch.find(',');
+            std::string_view tag = ifNoneMatch.substr(0, comma);
+            while (!tag.empty() && tag.front() == ' ')
+                tag.remove_prefix(1);
+            while (!tag.empty() && tag.back() == ' ')
+                tag.remove_suffix(1);
+            if (tag.substr(0, 2) == "W/")
+                tag.remove_prefix(2);
+            if (tag == "*" || tag == etag)
+            {
+                return true;
+            }
+            if (comma == std::string_view::npos)
+            {
+                break;
+            }
+            ifNoneMatch.remove_prefix(comma + 1);
+        }
+        return false;
+    }
+
+    // 基于响应体 FNV-1a 哈希的强 ETag
+    static std::string makeEtag(std::string_view body)
+    {
+        uint64_t hash = 1469598103934665603ULL;
+        for (unsigned char c : body)
+        {
+            hash ^= c;
+            hash *= 1099511628211ULL;
+        }
+        static const char *digits = "0123456789abcdef";
+        std::string etag(18, '"');
+        for (int i = 16; i >= 1; --i)
+        {
+            etag[i] = digits[hash & 0xf];
+            hash >>= 4;
+        }
+        return etag;
+    }
+
+private:
+    struct Node
+    {
+        std::string key;
+        EntryPtr entry;
+        size_t bytes;
+    };
+
+    struct Shard
+    {
+        std::mutex mutex;
+        std::list<Node> lru;
+        std::unordered_map<std::string, std::list<Node>::iterator> index;
+        size_t bytes = 0;
+    };
+
+    static int64_t nowSeconds()
+    {
+        return std::chrono::duration_cast<std::chrono::seconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+    Shard &shardFor(const std::string &key)
+    {
+        return shards_[std::hash<std::string>()(key) % shards_.size()];
+    }
+
+    static void erase(Shard &shard, std::list<Node>::iterator it)
+    {
+        shard.bytes -= it->bytes;
+        shard.index.erase(it->key);
+        shard.lru.erase(it);
+    }
+
+    std::vector<Shard> shards_;
+    size_t shardBudget_;
+};
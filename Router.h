@@ -1,17 +1,55 @@
 // Router.h
 #pragma once
 
+#include "AsyncResponse.h"
+#include "BodyStream.h"
 #include "HttpRequest.h"
 #include "HttpResponse.h"
+#include "PerformanceMonitor.h"
+#include "PreparedResponse.h"
+#include "ResponseCache.h"
+#include "StaticFile.h"
+#include "Task.h"
+#include <array>
 #include <functional>
-#include <map>
+#include <memory>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <vector>
 
+// 压缩前缀树（radix trie）路由，每个 HTTP 方法一棵树。
+// 路径支持 ":name" 参数段和位于末尾的 "*name" 通配段，
+// 匹配优先级为 静态 > 参数 > 通配，捕获的参数以 string_view 形式写入请求，查找过程不分配内存
 class Router
 {
 public:
     using HandlerCallback = std::function<void(const HttpRequest &, HttpResponse *)>;
 
+    // 异步处理函数在工作线程池中执行，通过完成对象回复，请求在完成前一直有效
+    using AsyncHandlerCallback = std::function<void(const HttpRequest &, ResponseCompletionPtr)>;
+
+    // 协程处理函数在 IO 线程上运行，可以 co_await 定时器、文件读取、上游请求和线程池任务，
+    // 请求在协程结束前一直有效
+    using CoroutineHandlerCallback = std::function<Task<HttpResponse>(const HttpRequest &)>;
+
+    // 流式上传的处理函数在请求头到达时调用，返回接收请求体的 BodyStream，请求在其销毁前一直有效。
+    // 返回空指针表示拒绝，直接发送 response 并关闭连接
+    using BodyStreamHandler = std::function<BodyStreamPtr(const HttpRequest &, HttpResponse *)>;
+
+    // 一条已注册的路由：普通处理函数，或启动时预先序列化好的静态响应
+    struct Route
+    {
+        HandlerCallback handler;
+        PreparedResponsePtr prepared;
+        CachePolicyPtr cache; // 非空时 GET/HEAD 响应可以进入响应缓存
+        StaticDirectoryPtr files; // 非空时由静态文件处理器响应
+        AsyncHandlerCallback asyncHandler; // 非空时交给工作线程池异步处理
+        CoroutineHandlerCallback coroutineHandler; // 非空时作为协程运行
+        BodyStreamHandler bodyStream; // 非空时请求体流式交给处理函数创建的 BodyStream
+        int statsSlot = PerformanceMonitor::kUnmatchedPath; // 性能监控中按路由统计的槽位
+    };
+
     Router()
     {
         // 设置默认处理函数
@@ -23,29 +61,63 @@ public:
         };
     }
 
-    void addRoute(const std::string &method, const std::string &path, HandlerCallback handler)
+    // 返回新注册的路由，调用方可以继续设置缓存等附加属性
+    Route &addRoute(const std::string &method, const std::string &path, HandlerCallback handler)
+    {
+        return addRoute(HttpRequest::stringToMethod(method), path, std::move(handler));
+    }
+
+    Route &addRoute(HttpRequest::Method method, const std::string &path, HandlerCallback handler)
+    {
+        Route *route = insert(method, path);
+        route->handler = std::move(handler);
+        return *route;
+    }
+
+    Route &addAsyncRoute(HttpRequest::Method method, const std::string &path, AsyncHandlerCallback handler)
+    {
+        Route *route = insert(method, path);
+        route->asyncHandler = std::move(handler);
+        return *route;
+    }
+
+    Route &addCoroutineRoute(HttpRequest::Method method, const std::string &path, CoroutineHandlerCallback handler)
+    {
+        Route *route = insert(method, path);
+        route->coroutineHandler = std::move(handler);
+        return *route;
+    }
+
+    Route &addStreamRoute(HttpRequest::Method method, const std::string &path, BodyStreamHandler handler)
+    {
+        Route *route = insert(method, path);
+        route->bodyStream = std::move(handler);
+        return *route;
+    }
+
+    void addStatic(HttpRequest::Method method, const std::string &path, PreparedResponsePtr prepared)
     {
-        routes_[method + path] = std::move(handler);
+        insert(method, path)->prepared = std::move(prepared);
     }
 
     void get(const std::string &path, HandlerCallback handler)
     {
-        addRoute("GET", path, std::move(handler));
+        addRoute(HttpRequest::kGet, path, std::move(handler));
     }
 
     void post(const std::string &path, HandlerCallback handler)
     {
-        addRoute("POST", path, std::move(handler));
+        addRoute(HttpRequest::kPost, path, std::move(handler));
     }
 
     void put(const std::string &path, HandlerCallback handler)
     {
-        addRoute("PUT", path, std::move(handler));
+        addRoute(HttpRequest::kPut, path, std::move(handler));
     }
 
     void del(const std::string &path, HandlerCallback handler)
     {
-        addRoute("DELETE", path, std::move(handler));
+        addRoute(HttpRequest::kDelete, path, std::move(handler));
     }
 
     void setDefaultHandler(HandlerCallback handler)
@@ -53,17 +125,30 @@ public:
         defaultHandler_ = std::move(handler);
     }
 
-    void route(const HttpRequest &req, HttpResponse *resp)
+    // 查找路由，捕获的参数写入 req；没有匹配时返回 nullptr。
+    // 没有单独注册的 HEAD 请求使用 GET 路由，响应体由服务器丢弃
+    const Route *match(HttpRequest &req) const
     {
-        std::string method = HttpRequest::methodToString(req.method());
-        std::string path = req.path();
-        std::string key = method + path;
+        const Route *route = matchIn(req.method(), req);
+        if (route == nullptr && req.method() == HttpRequest::kHead)
+        {
+            route = matchIn(HttpRequest::kGet, req);
+        }
+        return route;
+    }
 
-        auto it = routes_.find(key);
-        if (it != routes_.end())
+    void route(HttpRequest &req, HttpResponse *resp) const
+    {
+        dispatch(match(req), req, resp);
+    }
+
+    // 调用 match 得到的路由，route 为空时使用默认处理函数
+    void dispatch(const Route *route, const HttpRequest &req, HttpResponse *resp) const
+    {
+        if (route != nullptr && route->handler)
         {
             // 找到匹配的路由
-            it->second(req, resp);
+            route->handler(req, resp);
         }
         else
         {
@@ -73,6 +158,195 @@ public:
     }
 
 private:
-    std::map<std::string, HandlerCallback> routes_;
+    struct Node
+    {
+        std::string prefix;                          // 静态节点的路径片段
+        std::string indices;                         // 各静态子节点的首字符
+        std::vector<std::unique_ptr<Node>> children; // 静态子节点
+        std::unique_ptr<Node> paramChild;            // ":name" 子节点
+        std::unique_ptr<Node> wildcardChild;         // "*name" 子节点
+        std::string paramName;                       // 参数/通配节点的参数名
+        Route route;
+        bool hasRoute = false;
+    };
+
+    std::array<std::unique_ptr<Node>, HttpRequest::kMethodCount> trees_;
     HandlerCallback defaultHandler_;
+
+    const Route *matchIn(HttpRequest::Method method, HttpRequest &req) const
+    {
+        const Node *root = trees_[method].get();
+        if (root == nullptr)
+        {
+            return nullptr;
+        }
+        const Route *route = nullptr;
+        req.truncateParams(0);
+        if (!lookup(root, req.path(), req, &route))
+        {
+            req.truncateParams(0);
+        }
+        return route;
+    }
+
+    // 注册期的配置错误直接抛出，在启动阶段暴露
+    Route *insert(HttpRequest::Method method, const std::string &path)
+    {
+        if (method == HttpRequest::kInvalid)
+        {
+            throw std::invalid_argument("Router: unsupported method for " + path);
+        }
+        std::unique_ptr<Node> &root = trees_[method];
+        if (!root)
+        {
+            root = std::make_unique<Node>();
+        }
+
+        Node *node = insertAt(root.get(), path, path, 0);
+        if (node->hasRoute)
+        {
+            throw std::invalid_argument("Router: duplicate route " + path);
+        }
+        node->hasRoute = true;
+        node->route.statsSlot =
+            PerformanceMonitor::getInstance().registerPath(HttpRequest::methodToString(method) + " " + path);
+        return &node->route;
+    }
+
+    // node 的前缀已经完全匹配，把剩余路径 rest 挂到 node 下面
+    static Node *insertAt(Node *node, std::string_view rest, const std::string &path, size_t params)
+    {
+        while (!rest.empty())
+        {
+            if (rest[0] == ':' || rest[0] == '*')
+            {
+                bool wildcard = rest[0] == '*';
+                size_t end = wildcard ? rest.size() : rest.find('/');
+                if (end == std::string_view::npos)
+                {
+                    end = rest.size();
+                }
+                std::string_view name = rest.substr(1, end - 1);
+                if (name.empty() || (wildcard && name.find('/') != std::string_view::npos))
+                {
+                    throw std::invalid_argument("Router: bad parameter in " + path);
+                }
+                if (++params > HttpRequest::kMaxParams)
+                {
+                    throw std::invalid_argument("Router: too many parameters in " + path);
+                }
+
+                std::unique_ptr<Node> &child = wildcard ? node->wildcardChild : node->paramChild;
+                if (!child)
+                {
+                    child = std::make_unique<Node>();
+                    child->paramName = std::string(name);
+                }
+                else if (child->paramName != name)
+                {
+                    throw std::invalid_argument("Router: conflicting parameter name in " + path);
+                }
+                node = child.get();
+                rest.remove_prefix(end);
+                continue;
+            }
+
+            // 静态片段到下一个以 '/' 开头的参数段为止
+            size_t end = 0;
+            while (end < rest.size() &&
+                   !((rest[end] == ':' || rest[end] == '*') && end > 0 && rest[end - 1] == '/'))
+            {
+                ++end;
+            }
+            std::string_view text = rest.substr(0, end);
+
+            size_t i = node->indices.find(text[0]);
+            if (i == std::string::npos)
+            {
+                node->indices.push_back(text[0]);
+                node->children.push_back(std::make_unique<Node>());
+                node = node->children.back().get();
+                node->prefix = std::string(text);
+                rest.remove_prefix(end);
+                continue;
+            }
+
+            Node *child = node->children[i].get();
+            size_t common = 0;
+            while (common < text.size() && common < child->prefix.size() &&
+                   text[common] == child->prefix[common])
+            {
+                ++common;
+            }
+
+            if (common < child->prefix.size())
+            {
+                // 拆分已有节点：公共前缀成为新的中间节点
+                auto middle = std::make_unique<Node>();
+                middle->prefix = child->prefix.substr(0, common);
+                std::unique_ptr<Node> old = std::move(node->children[i]);
+                old->prefix.erase(0, common);
+                middle->indices.push_back(old->prefix[0]);
+                middle->children.push_back(std::move(old));
+                node->children[i] = std::move(middle);
+                child = node->children[i].get();
+            }
+
+            node = child;
+            rest.remove_prefix(common);
+        }
+        return node;
+    }
+
+    // path 为去掉 node 前缀之后的剩余路径
+    static bool lookup(const Node *node, std::string_view path, HttpRequest &req, const Route **out)
+    {
+        if (path.empty() && node->hasRoute)
+        {
+            *out = &node->route;
+            return true;
+        }
+
+        // 静态子节点
+        if (!path.empty())
+        {
+            size_t i = node->indices.find(path[0]);
+            if (i != std::string::npos)
+            {
+                const Node *child = node->children[i].get();
+                if (path.compare(0, child->prefix.size(), child->prefix) == 0 &&
+                    lookup(child, path.substr(child->prefix.size()), req, out))
+                {
+                    return true;
+                }
+            }
+        }
+
+        // 参数段匹配到下一个 '/'
+        if (node->paramChild && !path.empty() && path[0] != '/')
+        {
+            size_t end = path.find('/');
+            if (end == std::string_view::npos)
+            {
+                end = path.size();
+            }
+            size_t mark = req.paramCount();
+            req.addParam(node->paramChild->paramName, path.substr(0, end));
+            if (lookup(node->paramChild.get(), path.substr(end), req, out))
+            {
+                return true;
+            }
+            req.truncateParams(mark);
+        }
+
+        // 通配段吃掉剩余的全部路径
+        if (node->wildcardChild && node->wildcardChild->hasRoute)
+        {
+            req.addParam(node->wildcardChild->paramName, path);
+            *out = &node->wildcardChild->route;
+            return true;
+        }
+
+        return false;
+    }
 };
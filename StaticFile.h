@@ -0,0 +1,692 @@
+// StaticFile.h
+#pragma once
+
+#include "Compression.h"
+#include "HttpRequest.h"
+#include "HttpResponse.h"
+#include "WorkStealingPool.h"
+#include "cc_muduo/EventLoop.h"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cerrno>
+#include <ctime>
+#include <fcntl.h>
+#include <list>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <strings.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <utility>
+
+// 按扩展名查找 MIME 类型的编译期表
+struct MimeType
+{
+    std::string_view extension;
+    std::string_view type;
+};
+
+inline constexpr MimeType kMimeTypes[] = {
+    {"html", "text/html; charset=utf-8"},
+    {"htm", "text/html; charset=utf-8"},
+    {"css", "text/css; charset=utf-8"},
+    {"js", "application/javascript; charset=utf-8"},
+    {"mjs", "application/javascript; charset=utf-8"},
+    {"json", "application/json"},
+    {"txt", "text/plain; charset=utf-8"},
+    {"xml", "application/xml"},
+    {"svg", "image/svg+xml"},
+    {"png", "image/png"},
+    {"jpg", "image/jpeg"},
+    {"jpeg", "image/jpeg"},
+    {"gif", "image/gif"},
+    {"webp", "image/webp"},
+    {"ico", "image/x-icon"},
+    {"woff", "font/woff"},
+    {"woff2", "font/woff2"},
+    {"ttf", "font/ttf"},
+    {"wasm", "application/wasm"},
+    {"pdf", "application/pdf"},
+    {"zip", "application/zip"},
+    {"gz", "application/gzip"},
+    {"mp4", "video/mp4"},
+    {"webm", "video/webm"},
+    {"mp3", "audio/mpeg"},
+};
+
+inline std::string_view mimeTypeFor(std::string_view path)
+{
+    size_t dot = path.rfind('.');
+    if (dot != std::string_view::npos && path.find('/', dot) == std::string_view::npos)
+    {
+        std::string_view ext = path.substr(dot + 1);
+        for (const MimeType &mime : kMimeTypes)
+        {
+            if (mime.extension.size() == ext.size() &&
+                ::strncasecmp(mime.extension.data(), ext.data(), ext.size()) == 0)
+            {
+                return mime.type;
+            }
+        }
+    }
+    return "application/octet-stream";
+}
+
+// 文件内容及其 stat 元数据，多个请求共享，最后一个使用者关闭描述符。
+// 小文件复制到内存中；大文件只保持描述符打开，发送时按块 pread。
+// 不映射文件：文件被原地截断后访问映射页会触发 SIGBUS，pread 只会读到较短的长度
+struct CachedFile
+{
+    CachedFile() = default;
+    CachedFile(const CachedFile &) = delete;
+    CachedFile &operator=(const CachedFile &) = delete;
+
+    ~CachedFile()
+    {
+        if (fd >= 0)
+        {
+            ::close(fd);
+        }
+    }
+
+    bool inMemory() const { return fd < 0; }
+
+    // 从保持打开的大文件读取 [offset, offset + n) 到 out，文件被截断或读取出错时返回 false
+    bool read(size_t offset, size_t n, char *out) const
+    {
+        size_t done = 0;
+        while (done < n)
+        {
+            ssize_t r = ::pread(fd, out + done, n - done, static_cast<off_t>(offset + done));
+            if (r < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (r <= 0)
+            {
+                return false;
+            }
+            done += static_cast<size_t>(r);
+        }
+        return true;
+    }
+
+    size_t size = 0;
+    int fd = -1;      // 大文件保持打开，复制到内存中的为 -1
+    std::string copy; // 不超过 FileCache::kCopyMaxSize 的文件内容
+    time_t mtime = 0;
+    ino_t inode = 0;
+    std::string lastModified; // HTTP-date 格式
+    std::string_view contentType;
+    int64_t checkedAt = 0; // 上次 stat 校验的时间（秒）
+
+    // 生成压缩版本，压缩没有效果或读取文件失败时返回空。
+    // 只读取加载后不再修改的成员，可以在工作线程中调用
+    std::shared_ptr<const std::string> encode(Compression::Encoding encoding, const CompressionPolicy &policy) const
+    {
+        std::string contents;
+        std::string_view input(copy);
+        if (!inMemory())
+        {
+            contents.resize(size);
+            if (!read(0, size, contents.data()))
+            {
+                return nullptr;
+            }
+            input = contents;
+        }
+        std::string output;
+        if (!Compression::compress(encoding, input, &output, policy) || output.size() >= size)
+        {
+            return nullptr;
+        }
+        return std::make_shared<const std::string>(std::move(output));
+    }
+
+    enum EncodeState : uint8_t
+    {
+        kNotEncoded, // 还没有请求过该编码
+        kEncoding,   // 正在工作线程中生成
+        kEncoded     // 已生成，encodedData 为空表示压缩没有效果
+    };
+
+    // 压缩后的内容随文件缓存，由 FileCache::encoded 在所属的 IO 线程中读写，不需要加锁
+    mutable std::array<std::shared_ptr<const std::string>, Compression::kEncodingCount> encodedData;
+    mutable std::array<EncodeState, Compression::kEncodingCount> encodeState{};
+};
+
+using CachedFilePtr = std::shared_ptr<const CachedFile>;
+
+// 每个 IO 线程一个的文件缓存：保存读入的小文件、大文件的描述符和 stat 结果，
+// 按 LRU 淘汰，条目超过 revalidateSeconds 后重新 stat 检查文件是否被修改
+class FileCache
+{
+public:
+    static constexpr size_t kCopyMaxSize = 64 * 1024; // 不超过此大小的文件复制到内存中，更大的文件发送时按块读取
+
+    explicit FileCache(size_t capacity = 256, int revalidateSeconds = 2)
+        : capacity_(capacity), revalidateSeconds_(revalidateSeconds), pool_(nullptr), loop_(nullptr)
+    {
+    }
+
+    // 压缩版本在 pool 中生成，完成后投递回 loop（本缓存所属的 IO 线程）保存。
+    // 不设置时在 IO 线程中同步生成
+    void setEncodeWorkers(WorkStealingPool *pool, EventLoop *loop)
+    {
+        pool_ = pool;
+        loop_ = loop;
+    }
+
+    // 文件的压缩版本。第一次请求某个编码时交给工作线程生成，此时返回 nullptr 并设置 *pending，
+    // 调用方这次改用流式压缩或原始内容；压缩没有效果时返回 nullptr 且 *pending 为 false
+    const std::string *encoded(const CachedFilePtr &file, Compression::Encoding encoding,
+                               const CompressionPolicy &policy, bool *pending)
+    {
+        CachedFile::EncodeState &state = file->encodeState[encoding];
+        if (state == CachedFile::kNotEncoded)
+        {
+            if (pool_ == nullptr)
+            {
+                file->encodedData[encoding] = file->encode(encoding, policy);
+                state = CachedFile::kEncoded;
+            }
+            else
+            {
+                state = CachedFile::kEncoding;
+                // 任务持有文件的引用，期间文件即使被淘汰，描述符也保持打开
+                const CompressionPolicy *policyPtr = &policy;
+                EventLoop *loop = loop_;
+                pool_->submit([file, encoding, policyPtr, loop]()
+                              {
+                                  std::shared_ptr<const std::string> output = file->encode(encoding, *policyPtr);
+                                  loop->queueInLoop([file, encoding, output]()
+                                                    {
+                                                        file->encodedData[encoding] = output;
+                                                        file->encodeState[encoding] = CachedFile::kEncoded;
+                                                    });
+                              });
+            }
+        }
+        *pending = state == CachedFile::kEncoding;
+        return file->encodedData[encoding].get();
+    }
+
+    // 文件不存在或不是普通文件时返回 nullptr
+    CachedFilePtr open(const std::string &path)
+    {
+        int64_t now = nowSeconds();
+        auto it = index_.find(path);
+        if (it != index_.end())
+        {
+            Node &node = *it->second;
+            if (now - node.file->checkedAt < revalidateSeconds_)
+            {
+                lru_.splice(lru_.begin(), lru_, it->second);
+                return node.file;
+            }
+
+            struct stat st;
+            if (::stat(path.c_str(), &st) == 0 && st.st_mtime == node.file->mtime &&
+                st.st_ino == node.file->inode && static_cast<size_t>(st.st_size) == node.file->size)
+            {
+                const_cast<CachedFile &>(*node.file).checkedAt = now;
+                lru_.splice(lru_.begin(), lru_, it->second);
+                return node.file;
+            }
+            lru_.erase(it->second);
+            index_.erase(it);
+        }
+
+        CachedFilePtr file = load(path, now);
+        if (!file)
+        {
+            return nullptr;
+        }
+
+        lru_.push_front(Node{path, file});
+        index_[path] = lru_.begin();
+        if (lru_.size() > capacity_)
+        {
+            index_.erase(lru_.back().path);
+            lru_.pop_back();
+        }
+        return file;
+    }
+
+private:
+    struct Node
+    {
+        std::string path;
+        CachedFilePtr file;
+    };
+
+    static int64_t nowSeconds()
+    {
+        return std::chrono::duration_cast<std::chrono::seconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+    static CachedFilePtr load(const std::string &path, int64_t now)
+    {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            return nullptr;
+        }
+
+        struct stat st;
+        if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
+        {
+            ::close(fd);
+            return nullptr;
+        }
+
+        auto file = std::make_shared<CachedFile>();
+        file->size = static_cast<size_t>(st.st_size);
+        if (file->size <= kCopyMaxSize)
+        {
+            // 小文件读进内存，发送时不再读文件，也不占用描述符
+            file->copy.resize(file->size);
+            size_t done = 0;
+            while (done < file->size)
+            {
+                ssize_t n = ::pread(fd, &file->copy[done], file->size - done, static_cast<off_t>(done));
+                if (n < 0 && errno == EINTR)
+                {
+                    continue;
+                }
+                if (n <= 0)
+                {
+                    ::close(fd);
+                    return nullptr;
+                }
+                done += static_cast<size_t>(n);
+            }
+            ::close(fd);
+        }
+        else
+        {
+            file->fd = fd;
+        }
+
+        file->mtime = st.st_mtime;
+        file->inode = st.st_ino;
+        file->contentType = mimeTypeFor(path);
+        file->checkedAt = now;
+
+        char buf[64];
+        struct tm tm;
+        ::gmtime_r(&file->mtime, &tm);
+        size_t len = ::strftime(buf, sizeof buf, "%a, %d %b %Y %H:%M:%S GMT", &tm);
+        file->lastModified.assign(buf, len);
+        return file;
+    }
+
+    size_t capacity_;
+    int revalidateSeconds_;
+    WorkStealingPool *pool_;
+    EventLoop *loop_;
+    std::list<Node> lru_;
+    std::unordered_map<std::string, std::list<Node>::iterator> index_;
+};
+
+// 正在发送的文件响应体：文件原始内容、缓存的压缩版本，或者发送时流式压缩并按 chunked 编码分块
+struct FileBody
+{
+    CachedFilePtr file;
+    const char *data = nullptr; // 内存中的内容（小文件或压缩版本），为 nullptr 时从文件按块读取
+    size_t offset = 0;
+    size_t remaining = 0;
+    std::unique_ptr<Compression::Stream> encoder; // 非空时流式压缩
+
+    bool active() const { return remaining > 0; }
+
+    // 取出接下来最多 n 个字节：内存中的内容直接返回视图，否则读入 buffer。
+    // 文件被截断时返回 false
+    bool next(size_t n, std::string *buffer, std::string_view *chunk)
+    {
+        n = remaining < n ? remaining : n;
+        if (data != nullptr)
+        {
+            *chunk = std::string_view(data + offset, n);
+        }
+        else
+        {
+            buffer->resize(n);
+            if (!file->read(offset, n, buffer->data()))
+            {
+                return false;
+            }
+            *chunk = *buffer;
+        }
+        offset += n;
+        remaining -= n;
+        return true;
+    }
+
+    void reset()
+    {
+        file.reset();
+        data = nullptr;
+        offset = 0;
+        remaining = 0;
+        encoder.reset();
+    }
+};
+
+// 把 URL 前缀映射到磁盘目录的静态文件处理器
+class StaticDirectory
+{
+public:
+    explicit StaticDirectory(std::string root) : root_(std::move(root))
+    {
+        while (root_.size() > 1 && root_.back() == '/')
+        {
+            root_.pop_back();
+        }
+    }
+
+    // relativePath 为 URL 前缀之后的部分。
+    // 成功时 response 只包含头部（响应体由调用方通过 body 流式发送），
+    // 返回 false 表示路径非法或文件不存在。compression 非空时按 Accept-Encoding 压缩可压缩的文件
+    bool serve(const HttpRequest &request, std::string_view relativePath, FileCache &cache,
+               const CompressionPolicy *compression, HttpResponse *response, FileBody *body) const
+    {
+        thread_local std::string decoded;
+        if (!percentDecode(relativePath, &decoded) || !safePath(decoded))
+        {
+            return false;
+        }
+
+        thread_local std::string path;
+        path.assign(root_);
+        path += '/';
+        path += decoded;
+        if (decoded.empty() || decoded.back() == '/')
+        {
+            path += "index.html";
+        }
+
+        CachedFilePtr file = cache.open(path);
+        if (!file)
+        {
+            return false;
+        }
+
+        response->addHeader("Content-Type", file->contentType);
+        response->addHeader("Last-Modified", file->lastModified);
+        response->addHeader("Accept-Ranges", "bytes");
+
+        // If-Modified-Since：文件未修改时返回 304
+        std::string_view ims = request.getHeader(HttpHeader::kIfModifiedSince);
+        if (!ims.empty() && notModifiedSince(ims, file->mtime))
+        {
+            response->setStatusCode(HttpResponse::k304NotModified);
+            return true;
+        }
+
+        if (compression != nullptr && file->size >= compression->minSize &&
+            compression->compressibleType(file->contentType))
+        {
+            response->addHeader("Vary", "Accept-Encoding");
+            // 区间请求总是针对原始内容
+            if (request.getHeader(HttpHeader::kRange).empty() &&
+                serveEncoded(request, file, cache, *compression, response, body))
+            {
+                return true;
+            }
+        }
+
+        size_t begin = 0;
+        size_t length = file->size;
+        std::string_view range = request.getHeader(HttpHeader::kRange);
+        if (!range.empty())
+        {
+            RangeResult result = parseRange(range, file->size, &begin, &length);
+            if (result == kUnsatisfiable)
+            {
+                response->setStatusCode(HttpResponse::k416RangeNotSatisfiable);
+                response->addHeader("Content-Range", "bytes */" + std::to_string(file->size));
+                return true;
+            }
+            if (result == kPartial)
+            {
+                response->setStatusCode(HttpResponse::k206PartialContent);
+                response->addHeader("Content-Range", "bytes " + std::to_string(begin) + "-" +
+                                                         std::to_string(begin + length - 1) + "/" +
+                                                         std::to_string(file->size));
+            }
+        }
+
+        response->addHeader("Content-Length", std::to_string(length));
+        if (request.method() != HttpRequest::kHead)
+        {
+            body->data = file->inMemory() ? file->copy.data() : nullptr;
+            body->file = std::move(file);
+            body->offset = begin;
+            body->remaining = length;
+        }
+        return true;
+    }
+
+private:
+    // 不超过 maxBufferedSize 的文件发送缓存的压缩版本，压缩版本还在生成时与更大的文件一样发送时流式压缩，
+    // 长度未知，需要 chunked 编码，HTTP/1.0 客户端只能收到原始内容
+    static bool serveEncoded(const HttpRequest &request, const CachedFilePtr &file, FileCache &cache,
+                             const CompressionPolicy &policy, HttpResponse *response, FileBody *body)
+    {
+        Compression::Encoding encoding = Compression::negotiate(request.getHeader(HttpHeader::kAcceptEncoding));
+        if (encoding == Compression::kIdentity)
+        {
+            return false;
+        }
+
+        bool headOnly = request.method() == HttpRequest::kHead;
+        if (file->size <= policy.maxBufferedSize)
+        {
+            bool pending = false;
+            const std::string *encoded = cache.encoded(file, encoding, policy, &pending);
+            if (encoded != nullptr)
+            {
+                response->addHeader("Content-Encoding", Compression::name(encoding));
+                response->addHeader("Content-Length", std::to_string(encoded->size()));
+                if (!headOnly)
+                {
+                    body->file = file;
+                    body->data = encoded->data();
+                    body->offset = 0;
+                    body->remaining = encoded->size();
+                }
+                return true;
+            }
+            if (!pending)
+            {
+                // 压缩没有效果
+                return false;
+            }
+        }
+
+        if (request.version() == "HTTP/1.0")
+        {
+            return false;
+        }
+        response->addHeader("Content-Encoding", Compression::name(encoding));
+        response->addHeader("Transfer-Encoding", "chunked");
+        if (!headOnly)
+        {
+            body->file = file;
+            body->data = file->inMemory() ? file->copy.data() : nullptr;
+            body->offset = 0;
+            body->remaining = file->size;
+            body->encoder = std::make_unique<Compression::Stream>(encoding, policy);
+        }
+        return true;
+    }
+
+    enum RangeResult
+    {
+        kFull,         // 忽略 Range，发送整个文件
+        kPartial,      // 单个可满足的区间
+        kUnsatisfiable // 区间越界
+    };
+
+    // 只支持单个区间："bytes=a-b"、"bytes=a-"、"bytes=-n"，多区间按整文件发送
+    static RangeResult parseRange(std::string_view range, size_t size, size_t *begin, size_t *length)
+    {
+        if (range.substr(0, 6) != "bytes=" || range.find(',') != std::string_view::npos)
+        {
+            return kFull;
+        }
+        range.remove_prefix(6);
+        size_t dash = range.find('-');
+        if (dash == std::string_view::npos)
+        {
+            return kFull;
+        }
+
+        std::string_view first = range.substr(0, dash);
+        std::string_view last = range.substr(dash + 1);
+        uint64_t a = 0;
+        uint64_t b = 0;
+        if (first.empty())
+        {
+            // 最后 n 个字节
+            if (!parseNumber(last, &b))
+            {
+                return kFull;
+            }
+            if (b == 0 || size == 0)
+            {
+                return kUnsatisfiable;
+            }
+            *length = b < size ? b : size;
+            *begin = size - *length;
+            return kPartial;
+        }
+
+        if (!parseNumber(first, &a))
+        {
+            return kFull;
+        }
+        if (a >= size)
+        {
+            return kUnsatisfiable;
+        }
+        if (last.empty())
+        {
+            b = size - 1;
+        }
+        else if (!parseNumber(last, &b) || b < a)
+        {
+            return kFull;
+        }
+        if (b >= size)
+        {
+            b = size - 1;
+        }
+        *begin = a;
+        *length = b - a + 1;
+        return kPartial;
+    }
+
+    static bool parseNumber(std::string_view text, uint64_t *value)
+    {
+        if (text.empty() || text.size() > 19)
+        {
+            return false;
+        }
+        uint64_t result = 0;
+        for (char c : text)
+        {
+            if (c < '0' || c > '9')
+            {
+                return false;
+            }
+            result = result * 10 + static_cast<uint64_t>(c - '0');
+        }
+        *value = result;
+        return true;
+    }
+
+    static bool notModifiedSince(std::string_view ims, time_t mtime)
+    {
+        std::string text(ims);
+        struct tm tm = {};
+        const char *end = ::strptime(text.c_str(), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+        if (end == nullptr)
+        {
+            return false;
+        }
+        return mtime <= ::timegm(&tm);
+    }
+
+    static bool percentDecode(std::string_view in, std::string *out)
+    {
+        out->clear();
+        for (size_t i = 0; i < in.size(); ++i)
+        {
+            if (in[i] != '%')
+            {
+                out->push_back(in[i]);
+                continue;
+            }
+            if (i + 2 >= in.size())
+            {
+                return false;
+            }
+            int hi = hexValue(in[i + 1]);
+            int lo = hexValue(in[i + 2]);
+            if (hi < 0 || lo < 0)
+            {
+                return false;
+            }
+            out->push_back(static_cast<char>(hi * 16 + lo));
+            i += 2;
+        }
+        return true;
+    }
+
+    static int hexValue(char c)
+    {
+        if (c >= '0' && c <= '9')
+            return c - '0';
+        if (c >= 'a' && c <= 'f')
+            return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F')
+            return c - 'A' + 10;
+        return -1;
+    }
+
+    // 拒绝包含 ".." 路径段、反斜杠或 NUL 的路径
+    static bool safePath(std::string_view path)
+    {
+        if (path.find('\0') != std::string_view::npos || path.find('\\') != std::string_view::npos)
+        {
+            return false;
+        }
+        size_t start = 0;
+        while (start <= path.size())
+        {
+            size_t slash = path.find('/', start);
+            if (slash == std::string_view::npos)
+            {
+                slash = path.size();
+            }
+            if (path.substr(start, slash - start) == "..")
+            {
+                return false;
+            }
+            start = slash + 1;
+        }
+        return true;
+    }
+
+    std::string root_;
+};
+
+using StaticDirectoryPtr = std::shared_ptr<const StaticDirectory>;
@@ -0,0 +1,264 @@
+// Task.h
+#pragma once
+
+#include <array>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <new>
+#include <optional>
+#include <utility>
+
+// 协程帧的内存池，每个 IO 线程一个。按 64 字节分级的空闲链表，超过上限的帧直接走 operator new。
+// 协程帧只在所属 IO 线程创建、恢复和销毁，因此不需要加锁
+class FramePool
+{
+public:
+    static constexpr size_t kGranularity = 64;
+    static constexpr size_t kMaxPooledSize = 4096;
+    static constexpr size_t kClassCount = kMaxPooledSize / kGranularity;
+
+    FramePool() { freeLists_.fill(nullptr); }
+
+    ~FramePool()
+    {
+        for (FreeBlock *&head : freeLists_)
+        {
+            while (head != nullptr)
+            {
+                FreeBlock *next = head->next;
+                ::operator delete(head);
+                head = next;
+            }
+        }
+    }
+
+    FramePool(const FramePool &) = delete;
+    FramePool &operator=(const FramePool &) = delete;
+
+    // 当前线程的内存池，IO 线程初始化时设置；为空时协程帧直接使用 operator new
+    static FramePool *&current()
+    {
+        thread_local FramePool *pool = nullptr;
+        return pool;
+    }
+
+    static void *allocate(size_t size)
+    {
+        // 块头记录所属的内存池和大小级别，释放时不依赖当前线程
+        size_t total = size + sizeof(Header);
+        FramePool *pool = current();
+        void *block;
+        size_t sizeClass = (total + kGranularity - 1) / kGranularity;
+        if (pool != nullptr && sizeClass <= kClassCount)
+        {
+            block = pool->take(sizeClass);
+        }
+        else
+        {
+            pool = nullptr;
+            block = ::operator new(total);
+        }
+        Header *header = static_cast<Header *>(block);
+        header->pool = pool;
+        header->sizeClass = sizeClass;
+        return header + 1;
+    }
+
+    static void deallocate(void *ptr)
+    {
+        Header *header = static_cast<Header *>(ptr) - 1;
+        if (header->pool != nullptr)
+        {
+            header->pool->give(header, header->sizeClass);
+        }
+        else
+        {
+            ::operator delete(header);
+        }
+    }
+
+private:
+    struct alignas(std::max_align_t) Header
+    {
+        FramePool *pool;
+        size_t sizeClass;
+    };
+
+    struct FreeBlock
+    {
+        FreeBlock *next;
+    };
+
+    void *take(size_t sizeClass)
+    {
+        FreeBlock *&head = freeLists_[sizeClass - 1];
+        if (head == nullptr)
+        {
+            return ::operator new(sizeClass * kGranularity);
+        }
+        FreeBlock *block = head;
+        head = block->next;
+        return block;
+    }
+
+    void give(void *block, size_t sizeClass)
+    {
+        FreeBlock *free = static_cast<FreeBlock *>(block);
+        free->next = freeLists_[sizeClass - 1];
+        freeLists_[sizeClass - 1] = free;
+    }
+
+    std::array<FreeBlock *, kClassCount> freeLists_;
+};
+
+// 所有协程 promise 的公共基类：帧内存来自 FramePool
+struct PooledPromise
+{
+    static void *operator new(size_t size) { return FramePool::allocate(size); }
+    static void operator delete(void *ptr) { FramePool::deallocate(ptr); }
+    static void operator delete(void *ptr, size_t) { FramePool::deallocate(ptr); }
+};
+
+template <typename T>
+class Task;
+
+namespace detail
+{
+    // 协程结束时对称转移到等待它的协程
+    struct FinalAwaiter
+    {
+        bool await_ready() const noexcept { return false; }
+
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept
+        {
+            std::coroutine_handle<> continuation = handle.promise().continuation;
+            return continuation ? continuation : std::noop_coroutine();
+        }
+
+        void await_resume() const noexcept {}
+    };
+
+    struct TaskPromiseBase : PooledPromise
+    {
+        std::suspend_always initial_suspend() const noexcept { return {}; }
+        FinalAwaiter final_suspend() const noexcept { return {}; }
+        void unhandled_exception() { error = std::current_exception(); }
+
+        std::coroutine_handle<> continuation;
+        std::exception_ptr error;
+    };
+
+    template <typename T>
+    struct TaskPromise : TaskPromiseBase
+    {
+        Task<T> get_return_object();
+
+        template <typename U>
+        void return_value(U &&v) { value.emplace(std::forward<U>(v)); }
+
+        T result()
+        {
+            if (error)
+            {
+                std::rethrow_exception(error);
+            }
+            return std::move(*value);
+        }
+
+        std::optional<T> value;
+    };
+
+    template <>
+    struct TaskPromise<void> : TaskPromiseBase
+    {
+        Task<void> get_return_object();
+
+        void return_void() {}
+
+        void result()
+        {
+            if (error)
+            {
+                std::rethrow_exception(error);
+            }
+        }
+    };
+}
+
+// 惰性启动的协程任务：被 co_await 时才开始执行，结束后恢复等待者。
+// 处理函数返回 Task<HttpResponse>，内部可以 co_await 其他 Task 和 Awaitables.h 中的操作
+template <typename T>
+class Task
+{
+public:
+    using promise_type = detail::TaskPromise<T>;
+    using Handle = std::coroutine_handle<promise_type>;
+
+    explicit Task(Handle handle) : handle_(handle) {}
+    Task(Task &&other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+    Task &operator=(Task &&other) noexcept
+    {
+        if (this != &other)
+        {
+            if (handle_)
+            {
+                handle_.destroy();
+            }
+            handle_ = std::exchange(other.handle_, nullptr);
+        }
+        return *this;
+    }
+    Task(const Task &) = delete;
+    Task &operator=(const Task &) = delete;
+
+    ~Task()
+    {
+        if (handle_)
+        {
+            handle_.destroy();
+        }
+    }
+
+    bool await_ready() const noexcept { return false; }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+    {
+        handle_.promise().continuation = awaiting;
+        return handle_;
+    }
+
+    T await_resume() { return handle_.promise().result(); }
+
+private:
+    Handle handle_;
+};
+
+namespace detail
+{
+    template <typename T>
+    Task<T> TaskPromise<T>::get_return_object()
+    {
+        return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+    }
+
+    inline Task<void> TaskPromise<void>::get_return_object()
+    {
+        return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+    }
+}
+
+// 立即开始执行、结束后自行销毁的根协程，用于从普通代码中启动 Task
+struct DetachedTask
+{
+    struct promise_type : PooledPromise
+    {
+        DetachedTask get_return_object() const noexcept { return {}; }
+        std::suspend_never initial_suspend() const noexcept { return {}; }
+        std::suspend_never final_suspend() const noexcept { return {}; }
+        void return_void() const noexcept {}
+        // 根协程负责捕获自己的异常，漏出来说明程序有错误
+        void unhandled_exception() const noexcept { std::terminate(); }
+    };
+};
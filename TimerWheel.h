@@ -0,0 +1,146 @@
+// TimerWheel.h
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+// 哈希时间轮，每个 EventLoop 一个，只能在所属 IO 线程中使用。
+// 定时节点以侵入式双向链表的形式嵌入到使用者对象里，
+// arm / cancel 都是 O(1)，重复设置超时不会分配任何内存
+class TimerWheel
+{
+public:
+    class Node
+    {
+    public:
+        using Callback = std::function<void()>;
+
+        Node() : prev_(nullptr), next_(nullptr), expire_(0) {}
+        ~Node() { unlink(); }
+
+        Node(const Node &) = delete;
+        Node &operator=(const Node &) = delete;
+
+        // 到期回调只在建立时设置一次
+        void setCallback(Callback cb) { callback_ = std::move(cb); }
+
+        bool armed() const { return next_ != nullptr; }
+
+        void unlink()
+        {
+            if (next_ != nullptr)
+            {
+                prev_->next_ = next_;
+                next_->prev_ = prev_;
+                prev_ = nullptr;
+                next_ = nullptr;
+            }
+        }
+
+    private:
+        friend class TimerWheel;
+
+        void linkBefore(Node *head)
+        {
+            prev_ = head->prev_;
+            next_ = head;
+            head->prev_->next_ = this;
+            head->prev_ = this;
+        }
+
+        void makeHead()
+        {
+            prev_ = this;
+            next_ = this;
+        }
+
+        Node *prev_;
+        Node *next_;
+        uint64_t expire_; // 到期时的绝对刻度
+        Callback callback_;
+    };
+
+    explicit TimerWheel(size_t slotCount = 64)
+        : slots_(new Node[slotCount]), slotCount_(slotCount), now_(0)
+    {
+        for (size_t i = 0; i < slotCount_; ++i)
+        {
+            slots_[i].makeHead();
+        }
+    }
+
+    ~TimerWheel()
+    {
+        // 摘下所有仍挂在轮上的节点，避免它们析构时访问已释放的槽位
+        for (size_t i = 0; i < slotCount_; ++i)
+        {
+            Node *head = &slots_[i];
+            while (head->next_ != head)
+            {
+                head->next_->unlink();
+            }
+            head->prev_ = nullptr;
+            head->next_ = nullptr;
+        }
+    }
+
+    TimerWheel(const TimerWheel &) = delete;
+    TimerWheel &operator=(const TimerWheel &) = delete;
+
+    // 设置（或重置）节点在 ticks 个刻度后到期，超过一圈的超时按到期刻度区分
+    void arm(Node *node, uint32_t ticks)
+    {
+        node->unlink();
+        if (ticks == 0)
+        {
+            ticks = 1;
+        }
+        node->expire_ = now_ + ticks;
+        node->linkBefore(&slots_[node->expire_ % slotCount_]);
+    }
+
+    void cancel(Node *node) { node->unlink(); }
+
+    // 前进一个刻度，由 EventLoop 的周期定时器驱动
+    void tick()
+    {
+        ++now_;
+        Node *head = &slots_[now_ % slotCount_];
+
+        // 先把到期节点移到临时链表，回调里可能会重新 arm 或摘除其他节点
+        Node expired;
+        expired.makeHead();
+        Node *node = head->next_;
+        while (node != head)
+        {
+            Node *next = node->next_;
+            if (node->expire_ <= now_)
+            {
+                node->unlink();
+                node->linkBefore(&expired);
+            }
+            node = next;
+        }
+
+        while (expired.next_ != &expired)
+        {
+            Node *first = expired.next_;
+            first->unlink();
+            if (first->callback_)
+            {
+                first->callback_();
+            }
+        }
+        expired.prev_ = nullptr;
+        expired.next_ = nullptr;
+    }
+
+    uint64_t now() const { return now_; }
+
+private:
+    std::unique_ptr<Node[]> slots_;
+    size_t slotCount_;
+    uint64_t now_; // 当前刻度
+};
@@ -0,0 +1,121 @@
+// WorkStealingPool.cpp
+#include "WorkStealingPool.h"
+
+namespace
+{
+    // 当前线程所属的线程池及其队列序号，外部线程为空
+    thread_local const WorkStealingPool *t_pool = nullptr;
+    thread_local size_t t_queueIndex = 0;
+}
+
+WorkStealingPool::WorkStealingPool(size_t numThreads)
+{
+    if (numThreads == 0)
+    {
+        numThreads = 1;
+    }
+    for (size_t i = 0; i < numThreads; ++i)
+    {
+        queues_.push_back(std::make_unique<Queue>());
+    }
+    for (size_t i = 0; i < numThreads; ++i)
+    {
+        threads_.emplace_back(&WorkStealingPool::workerLoop, this, i);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex_);
+        stopping_ = true;
+    }
+    sleepCond_.notify_all();
+    for (auto &thread : threads_)
+    {
+        thread.join();
+    }
+}
+
+void WorkStealingPool::submit(Task task)
+{
+    size_t index = t_pool == this ? t_queueIndex
+                                  : nextQueue_.fetch_add(1, std::memory_order_relaxed) % queues_.size();
+    // 先计数再入队，工作线程取走任务时计数不会出现下溢
+    pending_.fetch_add(1, std::memory_order_release);
+    {
+        Queue &queue = *queues_[index];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(std::move(task));
+    }
+
+    // 只有存在休眠的工作线程时才需要唤醒
+    std::lock_guard<std::mutex> lock(sleepMutex_);
+    if (sleeping_ > 0)
+    {
+        sleepCond_.notify_one();
+    }
+}
+
+bool WorkStealingPool::popLocal(size_t index, Task *task)
+{
+    Queue &queue = *queues_[index];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty())
+    {
+        return false;
+    }
+    *task = std::move(queue.tasks.back());
+    queue.tasks.pop_back();
+    return true;
+}
+
+bool WorkStealingPool::steal(size_t index, Task *task)
+{
+    for (size_t i = 1; i < queues_.size(); ++i)
+    {
+        Queue &queue = *queues_[(index + i) % queues_.size()];
+        std::unique_lock<std::mutex> lock(queue.mutex, std::try_to_lock);
+        if (!lock.owns_lock() || queue.tasks.empty())
+        {
+            continue;
+        }
+        *task = std::move(queue.tasks.front());
+        queue.tasks.pop_front();
+        return true;
+    }
+    return false;
+}
+
+void WorkStealingPool::workerLoop(size_t index)
+{
+    t_pool = this;
+    t_queueIndex = index;
+
+    Task task;
+    for (;;)
+    {
+        if (popLocal(index, &task) || steal(index, &task))
+        {
+            pending_.fetch_sub(1, std::memory_order_relaxed);
+            task();
+            task = nullptr;
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex_);
+        if (pending_.load(std::memory_order_acquire) > 0)
+        {
+            // 有任务但还没入队，或窃取时恰好没拿到锁，再试一次
+            continue;
+        }
+        if (stopping_)
+        {
+            break;
+        }
+        ++sleeping_;
+        sleepCond_.wait(lock, [this]()
+                        { return stopping_ || pending_.load(std::memory_order_acquire) > 0; });
+        --sleeping_;
+    }
+}
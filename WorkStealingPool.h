@@ -0,0 +1,55 @@
+// WorkStealingPool.h
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 工作窃取线程池：每个工作线程一个双端队列，自己从尾部取任务，空闲时从其他队列头部窃取。
+// 外部线程提交的任务轮流放入各工作线程的队列，工作线程内提交的任务放入自己的队列。
+// 每个队列一把锁，只在窃取时与其他线程竞争
+class WorkStealingPool
+{
+public:
+    using Task = std::function<void()>;
+
+    explicit WorkStealingPool(size_t numThreads);
+    // 执行完已提交的任务后退出
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool &) = delete;
+    WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+    void submit(Task task);
+
+    size_t size() const { return queues_.size(); }
+
+private:
+    struct alignas(64) Queue
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void workerLoop(size_t index);
+    bool popLocal(size_t index, Task *task);
+    bool steal(size_t index, Task *task);
+
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<std::thread> threads_;
+
+    std::atomic<size_t> pending_{0}; // 已提交还未取走的任务数
+    std::atomic<size_t> nextQueue_{0};
+
+    // 没有任务时工作线程在这里休眠
+    std::mutex sleepMutex_;
+    std::condition_variable sleepCond_;
+    int sleeping_ = 0;
+    bool stopping_ = false;
+};
@@ -0,0 +1,88 @@
+// Allocations.cpp
+// 替换全局 operator new / delete 以统计内存分配。单独放在一个文件中，
+// 避免编译器把替换后的 delete 内联到使用方后误报分配函数不匹配
+#include "Bench.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+    std::atomic<uint64_t> g_allocations{0};
+    std::atomic<uint64_t> g_allocatedBytes{0};
+
+    void *countedAlloc(size_t size, size_t alignment)
+    {
+        g_allocations.fetch_add(1, std::memory_order_relaxed);
+        g_allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+        size = size != 0 ? size : 1;
+        void *p = nullptr;
+        if (alignment <= alignof(std::max_align_t))
+        {
+            p = std::malloc(size);
+        }
+        else
+        {
+            // aligned_alloc 要求大小是对齐的整数倍
+            p = std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+        }
+        return p;
+    }
+}
+
+void *operator new(size_t size)
+{
+    void *p = countedAlloc(size, 0);
+    if (p == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void *operator new[](size_t size)
+{
+    return ::operator new(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept
+{
+    return countedAlloc(size, 0);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept
+{
+    return countedAlloc(size, 0);
+}
+
+void *operator new(size_t size, std::align_val_t alignment)
+{
+    void *p = countedAlloc(size, static_cast<size_t>(alignment));
+    if (p == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void *operator new[](size_t size, std::align_val_t alignment)
+{
+    return ::operator new(size, alignment);
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+void operator delete[](void *p, size_t) noexcept { std::free(p); }
+void operator delete(void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void *p, size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void *p, size_t, std::align_val_t) noexcept { std::free(p); }
+
+namespace bench
+{
+    uint64_t allocationCount() { return g_allocations.load(std::memory_order_relaxed); }
+    uint64_t allocationBytes() { return g_allocatedBytes.load(std::memory_order_relaxed); }
+}
@@ -0,0 +1,49 @@
+// Bench.h
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// 微基准测试框架：每个基准是一个执行 iterations 次操作的函数，
+// 框架自动确定迭代次数，重复多轮取中位数，统计每次操作的耗时、内存分配次数和分配字节数
+namespace bench
+{
+    // 被测函数执行 iterations 次操作，由框架计时
+    using Function = std::function<void(uint64_t iterations)>;
+
+    struct Benchmark
+    {
+        std::string name;
+        Function function;
+    };
+
+    struct Result
+    {
+        std::string name;
+        uint64_t iterations = 0;
+        double nsPerOp = 0;
+        double allocsPerOp = 0;
+        double bytesPerOp = 0;
+    };
+
+    // 各基准文件在静态初始化阶段向其中添加基准
+    std::vector<Benchmark> &registry();
+
+    // 阻止编译器把结果未被使用的计算优化掉
+    template <typename T>
+    inline void doNotOptimize(const T &value)
+    {
+        asm volatile("" : : "r,m"(value) : "memory");
+    }
+
+    inline void clobberMemory()
+    {
+        asm volatile("" : : : "memory");
+    }
+
+    // 全局 operator new 的累计调用次数和字节数，所有线程共享
+    uint64_t allocationCount();
+    uint64_t allocationBytes();
+}
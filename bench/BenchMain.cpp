@@ -0,0 +1,274 @@
+// BenchMain.cpp
+#include "Bench.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace bench
+{
+    std::vector<Benchmark> &registry()
+    {
+        static std::vector<Benchmark> benchmarks;
+        return benchmarks;
+    }
+}
+
+namespace
+{
+    struct Options
+    {
+        std::string filter;
+        std::string output;   // 为空时 JSON 写到标准输出
+        std::string baseline; // 非空时与之比较
+        double minTime = 0.2; // 每轮至少运行的秒数
+        int repetitions = 5;
+        double threshold = 10; // 耗时增加超过该百分比视为退化
+        bool list = false;
+    };
+
+    void usage(const char *program)
+    {
+        std::fprintf(stderr,
+                     "Usage: %s [options]\n"
+                     "  --filter=TEXT        only run benchmarks whose name contains TEXT\n"
+                     "  --min-time=SECONDS   minimum time per repetition (default 0.2)\n"
+                     "  --repetitions=N      repetitions, the median is reported (default 5)\n"
+                     "  --out=FILE           write JSON results to FILE instead of stdout\n"
+                     "  --compare=FILE       compare against a saved JSON baseline, exit 1 on regression\n"
+                     "  --threshold=PERCENT  ns/op increase treated as regression (default 10)\n"
+                     "  --list               list benchmark names\n",
+                     program);
+    }
+
+    bool parseOptions(int argc, char *argv[], Options *options)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            std::string arg = argv[i];
+            size_t eq = arg.find('=');
+            std::string key = arg.substr(0, eq);
+            std::string value = eq == std::string::npos ? std::string() : arg.substr(eq + 1);
+            if (key == "--filter")
+                options->filter = value;
+            else if (key == "--out")
+                options->output = value;
+            else if (key == "--compare")
+                options->baseline = value;
+            else if (key == "--min-time")
+                options->minTime = std::atof(value.c_str());
+            else if (key == "--repetitions")
+                options->repetitions = std::max(1, std::atoi(value.c_str()));
+            else if (key == "--threshold")
+                options->threshold = std::atof(value.c_str());
+            else if (key == "--list")
+                options->list = true;
+            else
+                return false;
+        }
+        return true;
+    }
+
+    double elapsedNs(const bench::Function &function, uint64_t iterations)
+    {
+        auto start = std::chrono::steady_clock::now();
+        function(iterations);
+        bench::clobberMemory();
+        auto end = std::chrono::steady_clock::now();
+        return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+    }
+
+    bench::Result run(const bench::Benchmark &benchmark, const Options &options)
+    {
+        // 预热一次，然后增加迭代次数直到一轮的耗时达到 minTime
+        benchmark.function(1);
+        const double target = options.minTime * 1e9;
+        uint64_t iterations = 1;
+        for (;;)
+        {
+            double ns = elapsedNs(benchmark.function, iterations);
+            if (ns >= target || iterations >= (uint64_t(1) << 40))
+            {
+                break;
+            }
+            double scale = ns > 0 ? target / ns * 1.2 : 100;
+            iterations = static_cast<uint64_t>(static_cast<double>(iterations) * std::min(std::max(scale, 2.0), 100.0));
+        }
+
+        std::vector<double> nsPerOp;
+        double allocsPerOp = 0;
+        double bytesPerOp = 0;
+        for (int i = 0; i < options.repetitions; ++i)
+        {
+            uint64_t allocations = bench::allocationCount();
+            uint64_t bytes = bench::allocationBytes();
+            double ns = elapsedNs(benchmark.function, iterations);
+            double n = static_cast<double>(iterations);
+            nsPerOp.push_back(ns / n);
+            // 各轮的分配数应当相同，取最小值排除偶发的扩容
+            double a = static_cast<double>(bench::allocationCount() - allocations) / n;
+            double b = static_cast<double>(bench::allocationBytes() - bytes) / n;
+            allocsPerOp = i == 0 ? a : std::min(allocsPerOp, a);
+            bytesPerOp = i == 0 ? b : std::min(bytesPerOp, b);
+        }
+        std::sort(nsPerOp.begin(), nsPerOp.end());
+
+        bench::Result result;
+        result.name = benchmark.name;
+        result.iterations = iterations;
+        result.nsPerOp = nsPerOp[nsPerOp.size() / 2];
+        result.allocsPerOp = allocsPerOp;
+        result.bytesPerOp = bytesPerOp;
+        return result;
+    }
+
+    // 每个基准单独一行，--compare 读取时逐行解析
+    std::string toJson(const std::vector<bench::Result> &results)
+    {
+        std::string json = "{\n  \"benchmarks\": [\n";
+        char line[512];
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            const bench::Result &r = results[i];
+            std::snprintf(line, sizeof line,
+                          "    {\"name\": \"%s\", \"iterations\": %llu, \"ns_per_op\": %.3f, "
+                          "\"allocs_per_op\": %.3f, \"bytes_per_op\": %.1f}%s\n",
+                          r.name.c_str(), static_cast<unsigned long long>(r.iterations), r.nsPerOp,
+                          r.allocsPerOp, r.bytesPerOp, i + 1 < results.size() ? "," : "");
+            json += line;
+        }
+        json += "  ]\n}\n";
+        return json;
+    }
+
+    double numberField(const std::string &line, const char *key)
+    {
+        std::string pattern = std::string("\"") + key + "\": ";
+        size_t pos = line.find(pattern);
+        return pos == std::string::npos ? 0 : std::atof(line.c_str() + pos + pattern.size());
+    }
+
+    bool loadBaseline(const std::string &path, std::unordered_map<std::string, bench::Result> *baseline)
+    {
+        std::ifstream in(path);
+        if (!in)
+        {
+            return false;
+        }
+        std::string line;
+        while (std::getline(in, line))
+        {
+            static const std::string kName = "\"name\": \"";
+            size_t pos = line.find(kName);
+            if (pos == std::string::npos)
+            {
+                continue;
+            }
+            size_t start = pos + kName.size();
+            size_t end = line.find('"', start);
+            bench::Result r;
+            r.name = line.substr(start, end - start);
+            r.nsPerOp = numberField(line, "ns_per_op");
+            r.allocsPerOp = numberField(line, "allocs_per_op");
+            r.bytesPerOp = numberField(line, "bytes_per_op");
+            (*baseline)[r.name] = r;
+        }
+        return true;
+    }
+
+    // 耗时增加超过阈值或每次操作多分配了内存都视为退化
+    int compare(const std::vector<bench::Result> &results,
+                const std::unordered_map<std::string, bench::Result> &baseline, double threshold)
+    {
+        int regressions = 0;
+        std::fprintf(stderr, "\n%-48s %12s %12s %9s %10s\n", "benchmark", "base ns/op", "ns/op", "delta", "allocs/op");
+        for (const auto &r : results)
+        {
+            auto it = baseline.find(r.name);
+            if (it == baseline.end())
+            {
+                std::fprintf(stderr, "%-48s %12s %12.2f %9s %10.2f  new\n", r.name.c_str(), "-", r.nsPerOp, "-",
+                             r.allocsPerOp);
+                continue;
+            }
+            const bench::Result &base = it->second;
+            double delta = base.nsPerOp > 0 ? (r.nsPerOp - base.nsPerOp) / base.nsPerOp * 100 : 0;
+            bool slower = delta > threshold;
+            bool moreAllocs = r.allocsPerOp > base.allocsPerOp + 0.01;
+            if (slower || moreAllocs)
+            {
+                ++regressions;
+            }
+            std::fprintf(stderr, "%-48s %12.2f %12.2f %+8.1f%% %10.2f  %s\n", r.name.c_str(), base.nsPerOp,
+                         r.nsPerOp, delta, r.allocsPerOp,
+                         slower ? "REGRESSION" : (moreAllocs ? "REGRESSION (allocs)" : ""));
+        }
+        std::fprintf(stderr, "%d regression(s), threshold %.1f%%\n", regressions, threshold);
+        return regressions;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    Options options;
+    if (!parseOptions(argc, argv, &options))
+    {
+        usage(argv[0]);
+        return 2;
+    }
+
+    std::vector<bench::Benchmark> benchmarks = bench::registry();
+    std::sort(benchmarks.begin(), benchmarks.end(),
+              [](const bench::Benchmark &a, const bench::Benchmark &b)
+              { return a.name < b.name; });
+
+    std::vector<bench::Result> results;
+    for (const auto &benchmark : benchmarks)
+    {
+        if (!options.filter.empty() && benchmark.name.find(options.filter) == std::string::npos)
+        {
+            continue;
+        }
+        if (options.list)
+        {
+            std::printf("%s\n", benchmark.name.c_str());
+            continue;
+        }
+        bench::Result result = run(benchmark, options);
+        std::fprintf(stderr, "%-48s %12.2f ns/op %8.2f allocs/op %10.1f B/op\n", result.name.c_str(),
+                     result.nsPerOp, result.allocsPerOp, result.bytesPerOp);
+        results.push_back(result);
+    }
+    if (options.list)
+    {
+        return 0;
+    }
+
+    std::string json = toJson(results);
+    if (options.output.empty())
+    {
+        std::fputs(json.c_str(), stdout);
+    }
+    else
+    {
+        std::ofstream out(options.output);
+        out << json;
+    }
+
+    if (!options.baseline.empty())
+    {
+        std::unordered_map<std::string, bench::Result> baseline;
+        if (!loadBaseline(options.baseline, &baseline))
+        {
+            std::fprintf(stderr, "cannot read baseline %s\n", options.baseline.c_str());
+            return 2;
+        }
+        return compare(results, baseline, options.threshold) > 0 ? 1 : 0;
+    }
+    return 0;
+}
@@ -0,0 +1,196 @@
+// MonitorBench.cpp
+// PerformanceMonitor 在多线程同时记录时的开销，以及记录进行中生成报告的耗时。
+// 工作线程在第一次使用时创建并一直保留，监控器按线程分片，反复创建线程会让分片越来越多
+#include "Bench.h"
+#include "PerformanceMonitor.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    // 一组常驻线程，run 让每个线程以自己的序号执行一次 task，全部结束后返回
+    class Team
+    {
+    public:
+        explicit Team(int size)
+        {
+            for (int i = 0; i < size; ++i)
+            {
+                threads_.emplace_back([this, i]()
+                                      { loop(i); });
+            }
+        }
+
+        ~Team()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stop_ = true;
+                ++generation_;
+            }
+            wake_.notify_all();
+            for (auto &thread : threads_)
+            {
+                thread.join();
+            }
+        }
+
+        void run(const std::function<void(int)> &task)
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            task_ = &task;
+            pending_ = static_cast<int>(threads_.size());
+            ++generation_;
+            wake_.notify_all();
+            done_.wait(lock, [this]()
+                       { return pending_ == 0; });
+            task_ = nullptr;
+        }
+
+    private:
+        void loop(int index)
+        {
+            uint64_t seen = 0;
+            for (;;)
+            {
+                const std::function<void(int)> *task;
+                {
+                    std::unique_lock<std::mutex> lock(mutex_);
+                    wake_.wait(lock, [this, seen]()
+                               { return generation_ != seen; });
+                    seen = generation_;
+                    if (stop_)
+                    {
+                        return;
+                    }
+                    task = task_;
+                }
+                (*task)(index);
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    if (--pending_ == 0)
+                    {
+                        done_.notify_one();
+                    }
+                }
+            }
+        }
+
+        std::vector<std::thread> threads_;
+        std::mutex mutex_;
+        std::condition_variable wake_;
+        std::condition_variable done_;
+        const std::function<void(int)> *task_ = nullptr;
+        uint64_t generation_ = 0;
+        int pending_ = 0;
+        bool stop_ = false;
+    };
+
+    Team &team(int size)
+    {
+        // 每种线程数一组，程序退出时回收
+        static std::mutex mutex;
+        static std::vector<std::unique_ptr<Team>> teams(64);
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!teams[size])
+        {
+            teams[size] = std::make_unique<Team>(size);
+        }
+        return *teams[size];
+    }
+
+    // 8 条路由的统计槽位，和服务器一样在注册时分配
+    const std::array<int, 8> &pathSlots()
+    {
+        static const std::array<int, 8> slots = []()
+        {
+            const char *patterns[] = {"GET /", "GET /hello", "POST /echo", "GET /monitor", "GET /api/v1/users/:id",
+                                      "GET /static/*filepath", "GET /favicon.ico", "GET /delay"};
+            std::array<int, 8> result{};
+            for (size_t i = 0; i < result.size(); ++i)
+            {
+                result[i] = PerformanceMonitor::getInstance().registerPath(patterns[i]);
+            }
+            return result;
+        }();
+        return slots;
+    }
+
+    struct Registration
+    {
+        Registration()
+        {
+            int hardware = static_cast<int>(std::thread::hardware_concurrency());
+            for (int threads : {1, 2, 4, 8})
+            {
+                if (threads > 1 && threads > hardware)
+                {
+                    continue;
+                }
+                std::string suffix = "/threads:" + std::to_string(threads);
+
+                // 每个线程各执行 iterations 次，ns/op 为每次记录的墙钟耗时
+                bench::registry().push_back(bench::Benchmark{
+                    "monitor/record_request" + suffix, [threads](uint64_t iterations)
+                    {
+                        team(threads).run([iterations](int)
+                                          {
+                                              PerformanceMonitor &monitor = PerformanceMonitor::getInstance();
+                                              for (uint64_t i = 0; i < iterations; ++i)
+                                              {
+                                                  monitor.recordRequest(static_cast<int64_t>(i & 0xfffff) * 100);
+                                              } });
+                    }});
+
+                bench::registry().push_back(bench::Benchmark{
+                    "monitor/record_path" + suffix, [threads](uint64_t iterations)
+                    {
+                        team(threads).run([iterations](int index)
+                                          {
+                                              PerformanceMonitor &monitor = PerformanceMonitor::getInstance();
+                                              const std::array<int, 8> &slots = pathSlots();
+                                              for (uint64_t i = 0; i < iterations; ++i)
+                                              {
+                                                  monitor.recordPath(slots[(i + index) % 8]);
+                                              } });
+                    }});
+            }
+
+            // 其他线程持续记录时生成 iterations 份报告
+            int recorders = std::max(1, std::min(4, hardware - 1));
+            bench::registry().push_back(bench::Benchmark{
+                "monitor/report/recorders:" + std::to_string(recorders), [recorders](uint64_t iterations)
+                {
+                    std::atomic<bool> stop{false};
+                    team(recorders + 1).run([&stop, iterations](int index)
+                                            {
+                                                PerformanceMonitor &monitor = PerformanceMonitor::getInstance();
+                                                const std::array<int, 8> &slots = pathSlots();
+                                                if (index == 0)
+                                                {
+                                                    for (uint64_t i = 0; i < iterations; ++i)
+                                                    {
+                                                        std::string report = monitor.getStatisticsReport();
+                                                        bench::doNotOptimize(report);
+                                                    }
+                                                    stop.store(true, std::memory_order_relaxed);
+                                                    return;
+                                                }
+                                                for (uint64_t i = 0; !stop.load(std::memory_order_relaxed); ++i)
+                                                {
+                                                    monitor.recordRequest(static_cast<int64_t>(i & 0xfffff) * 100);
+                                                    monitor.recordPath(slots[i % 8]);
+                                                } });
+                }});
+        }
+    } registration;
+}
@@ -0,0 +1,54 @@
+// ResponseBench.cpp
+// HttpResponse 序列化在不同响应体大小下的耗时：toString 每次返回新字符串，
+// appendToBuffer 写入复用的输出缓冲区，与服务器的发送路径相同
+#include "Bench.h"
+#include "HttpResponse.h"
+
+#include <string>
+
+namespace
+{
+    HttpResponse makeResponse(size_t bodySize)
+    {
+        HttpResponse response;
+        response.setStatusCode(HttpResponse::k200Ok);
+        response.setContentType("application/json");
+        response.addHeader("Cache-Control", "no-cache");
+        response.addHeader("X-Request-Id", "4bf92f3577b34da6a3ce929d0e0e4736");
+        response.setBody(std::string(bodySize, 'x'));
+        return response;
+    }
+
+    struct Registration
+    {
+        Registration()
+        {
+            for (size_t size : {0, 128, 4096, 65536})
+            {
+                std::string suffix = "/" + std::to_string(size);
+                bench::registry().push_back(bench::Benchmark{
+                    "response/to_string" + suffix, [size](uint64_t iterations)
+                    {
+                        HttpResponse response = makeResponse(size);
+                        for (uint64_t i = 0; i < iterations; ++i)
+                        {
+                            std::string bytes = response.toString();
+                            bench::doNotOptimize(bytes);
+                        }
+                    }});
+                bench::registry().push_back(bench::Benchmark{
+                    "response/append" + suffix, [size](uint64_t iterations)
+                    {
+                        HttpResponse response = makeResponse(size);
+                        std::string output;
+                        for (uint64_t i = 0; i < iterations; ++i)
+                        {
+                            output.clear();
+                            response.appendToBuffer(&output);
+                            bench::doNotOptimize(output);
+                        }
+                    }});
+            }
+        }
+    } registration;
+}
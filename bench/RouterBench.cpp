@@ -0,0 +1,84 @@
+// RouterBench.cpp
+// Router::route 在 10 / 100 / 1000 条路由下的查找和分发耗时，路由表混合静态路径和参数路径
+#include "Bench.h"
+#include "Router.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+    // 每 4 条路由中 1 条带参数，与常见的 REST 服务相近
+    std::string routePath(size_t i)
+    {
+        std::string resource = "/api/v" + std::to_string(i % 3 + 1) + "/resource" + std::to_string(i);
+        return i % 4 == 0 ? resource + "/:id/items" : resource;
+    }
+
+    std::string requestPath(size_t i)
+    {
+        std::string resource = "/api/v" + std::to_string(i % 3 + 1) + "/resource" + std::to_string(i);
+        return i % 4 == 0 ? resource + "/12345/items" : resource;
+    }
+
+    struct Fixture
+    {
+        Fixture(size_t routeCount, bool miss)
+        {
+            for (size_t i = 0; i < routeCount; ++i)
+            {
+                router.get(routePath(i), [](const HttpRequest &, HttpResponse *resp)
+                           { resp->setStatusCode(HttpResponse::k200Ok); });
+            }
+            // 请求依次访问全部路由，避免只测到同一条路径
+            for (size_t i = 0; i < routeCount; ++i)
+            {
+                paths.push_back(miss ? requestPath(i) + "/missing" : requestPath(i));
+            }
+            request.setMethod(HttpRequest::kGet);
+        }
+
+        Router router;
+        std::vector<std::string> paths;
+        HttpRequest request;
+        HttpResponse response;
+    };
+
+    void routeLoop(Fixture &fixture, uint64_t iterations)
+    {
+        size_t next = 0;
+        for (uint64_t i = 0; i < iterations; ++i)
+        {
+            fixture.request.setPath(fixture.paths[next]);
+            fixture.router.route(fixture.request, &fixture.response);
+            bench::doNotOptimize(fixture.response);
+            next = next + 1 == fixture.paths.size() ? 0 : next + 1;
+        }
+    }
+
+    struct Registration
+    {
+        Registration()
+        {
+            for (size_t count : {10, 100, 1000})
+            {
+                for (bool miss : {false, true})
+                {
+                    std::string name = "router/" + std::to_string(count) + (miss ? "/miss" : "/hit");
+                    // 路由表在第一次（预热）调用时建立，不计入测量
+                    auto fixture = std::make_shared<std::unique_ptr<Fixture>>();
+                    bench::registry().push_back(bench::Benchmark{
+                        name, [fixture, count, miss](uint64_t iterations)
+                        {
+                            if (!*fixture)
+                            {
+                                *fixture = std::make_unique<Fixture>(count, miss);
+                            }
+                            routeLoop(**fixture, iterations);
+                        }});
+                }
+            }
+        }
+    } registration;
+}
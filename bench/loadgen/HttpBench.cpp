@@ -0,0 +1,327 @@
+// HttpBench.cpp
+// 端到端压测：通过回环地址向 HttpServer 发送请求，报告 RPS、状态码和完整的延迟分布。
+// --embedded 在进程内启动与 main.cpp 相同路由的服务器，没有网络的 CI 机器上也能检查吞吐退化
+#include "DemoRoutes.h"
+#include "HttpServer.h"
+#include "LoadGenerator.h"
+#include "Logger.h"
+#include "cc_muduo/EventLoop.h"
+#include "cc_muduo/EventLoopThread.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+    struct Options
+    {
+        LoadConfig load;
+        std::string ip = "127.0.0.1";
+        uint16_t port = 2000;
+        bool embedded = false;
+        int serverThreads = 4;
+        std::string output;    // 为空时 JSON 写到标准输出
+        std::string baseline;  // 非空时与之比较
+        double threshold = 10; // 闭环 RPS 下降或开环 p99 上升超过该百分比视为退化
+    };
+
+    void usage(const char *program)
+    {
+        std::fprintf(stderr,
+                     "Usage: %s [options]\n"
+                     "  --embedded            start the demo server in-process and benchmark it over loopback\n"
+                     "  --server-threads=N    IO threads of the embedded server (default 4)\n"
+                     "  --ip=ADDR --port=N    server to benchmark (default 127.0.0.1:2000)\n"
+                     "  --connections=N       concurrent connections (default 64)\n"
+                     "  --threads=N           client event loop threads (default 2)\n"
+                     "  --pipeline=N          requests in flight per connection (default 1)\n"
+                     "  --no-keep-alive       one request per connection\n"
+                     "  --rate=RPS            open-loop mode at a constant total request rate;\n"
+                     "                        latency is measured from the scheduled send time\n"
+                     "  --duration=SECONDS    measured duration (default 10)\n"
+                     "  --warmup=SECONDS      unmeasured warmup (default 2)\n"
+                     "  --request=W,METHOD,PATH[,BODY]\n"
+                     "                        add a request to the mix with weight W, may be repeated\n"
+                     "                        (default 8,GET,/hello 1,GET,/ 1,POST,/echo,{...})\n"
+                     "  --out=FILE            write the JSON result to FILE instead of stdout\n"
+                     "  --compare=FILE        compare against a saved JSON result, exit 1 on regression\n"
+                     "  --threshold=PERCENT   closed-loop rps drop or open-loop p99 increase\n"
+                     "                        treated as regression (default 10)\n",
+                     program);
+    }
+
+    bool parseRequest(const std::string &text, LoadRequest *request)
+    {
+        size_t first = text.find(',');
+        size_t second = first == std::string::npos ? std::string::npos : text.find(',', first + 1);
+        if (second == std::string::npos)
+        {
+            return false;
+        }
+        size_t third = text.find(',', second + 1);
+        request->weight = std::atoi(text.substr(0, first).c_str());
+        request->method = text.substr(first + 1, second - first - 1);
+        request->path = text.substr(second + 1, third == std::string::npos ? std::string::npos : third - second - 1);
+        // 请求体可以包含逗号
+        request->body = third == std::string::npos ? std::string() : text.substr(third + 1);
+        return request->weight > 0 && !request->method.empty() && !request->path.empty() && request->path[0] == '/';
+    }
+
+    bool parseOptions(int argc, char *argv[], Options *options)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            std::string arg = argv[i];
+            size_t eq = arg.find('=');
+            std::string key = arg.substr(0, eq);
+            std::string value = eq == std::string::npos ? std::string() : arg.substr(eq + 1);
+            if (key == "--embedded")
+                options->embedded = true;
+            else if (key == "--server-threads")
+                options->serverThreads = std::atoi(value.c_str());
+            else if (key == "--ip")
+                options->ip = value;
+            else if (key == "--port")
+                options->port = static_cast<uint16_t>(std::atoi(value.c_str()));
+            else if (key == "--connections")
+                options->load.connections = std::atoi(value.c_str());
+            else if (key == "--threads")
+                options->load.threads = std::atoi(value.c_str());
+            else if (key == "--pipeline")
+                options->load.pipeline = std::max(1, std::atoi(value.c_str()));
+            else if (key == "--no-keep-alive")
+                options->load.keepAlive = false;
+            else if (key == "--rate")
+                options->load.rate = std::atof(value.c_str());
+            else if (key == "--duration")
+                options->load.duration = std::atof(value.c_str());
+            else if (key == "--warmup")
+                options->load.warmup = std::atof(value.c_str());
+            else if (key == "--request")
+            {
+                LoadRequest request;
+                if (!parseRequest(value, &request))
+                    return false;
+                options->load.mix.push_back(request);
+            }
+            else if (key == "--out")
+                options->output = value;
+            else if (key == "--compare")
+                options->baseline = value;
+            else if (key == "--threshold")
+                options->threshold = std::atof(value.c_str());
+            else
+                return false;
+        }
+        options->load.threads = std::min(options->load.threads, options->load.connections);
+        return options->load.duration > 0 && options->load.connections > 0 && options->load.threads > 0;
+    }
+
+    // 示例服务的请求组合：以固定内容的小响应为主，少量首页和 POST 回显
+    std::vector<LoadRequest> defaultMix()
+    {
+        std::vector<LoadRequest> mix(3);
+        mix[0].weight = 8;
+        mix[0].path = "/hello";
+        mix[1].weight = 1;
+        mix[1].path = "/";
+        mix[2].weight = 1;
+        mix[2].method = "POST";
+        mix[2].path = "/echo";
+        mix[2].body = "{\"customer\":42,\"items\":[{\"sku\":\"A-1001\",\"qty\":2}]}";
+        return mix;
+    }
+
+    // 在独立的 EventLoopThread 中运行与 main.cpp 相同配置的服务器
+    class EmbeddedServer
+    {
+    public:
+        EmbeddedServer(const InetAddress &listenAddr, int threads)
+            : loop_(thread_.startLoop())
+        {
+            runAndWait([this, listenAddr, threads]()
+                       {
+                           server_ = std::make_unique<HttpServer>(loop_, listenAddr, "HttpBench-server");
+                           server_->setThreadNum(threads);
+                           configureDemoServer(*server_);
+                           server_->start(); });
+        }
+
+        ~EmbeddedServer()
+        {
+            runAndWait([this]()
+                       { server_.reset(); });
+        }
+
+        EmbeddedServer(const EmbeddedServer &) = delete;
+        EmbeddedServer &operator=(const EmbeddedServer &) = delete;
+
+    private:
+        void runAndWait(std::function<void()> task)
+        {
+            std::promise<void> done;
+            loop_->runInLoop([&task, &done]()
+                             {
+                                 task();
+                                 done.set_value(); });
+            done.get_future().wait();
+        }
+
+        EventLoopThread thread_;
+        EventLoop *loop_;
+        std::unique_ptr<HttpServer> server_;
+    };
+
+    // 单行 JSON，--compare 按字段名读取
+    std::string toJson(const Options &options, const LoadResult &result)
+    {
+        const LatencyHistogram &latency = result.latency;
+        auto us = [](uint64_t ns)
+        { return static_cast<double>(ns) / 1e3; };
+        char line[1024];
+        std::snprintf(line, sizeof line,
+                      "{\"mode\": \"%s\", \"target_rps\": %.1f, \"connections\": %d, \"threads\": %d, "
+                      "\"pipeline\": %d, \"keep_alive\": %s, \"seconds\": %.3f, \"requests\": %llu, "
+                      "\"rps\": %.1f, \"bytes_per_sec\": %.0f, \"errors\": %llu, \"incomplete\": %llu, "
+                      "\"min_us\": %.1f, \"mean_us\": %.1f, \"p50_us\": %.1f, \"p90_us\": %.1f, "
+                      "\"p99_us\": %.1f, \"p999_us\": %.1f, \"max_us\": %.1f, \"status\": {",
+                      options.load.rate > 0 ? "open" : "closed", options.load.rate, options.load.connections,
+                      options.load.threads, options.load.pipeline, options.load.keepAlive ? "true" : "false",
+                      result.seconds, static_cast<unsigned long long>(result.requests), result.rps(),
+                      result.seconds > 0 ? static_cast<double>(result.bytes) / result.seconds : 0,
+                      static_cast<unsigned long long>(result.errors()),
+                      static_cast<unsigned long long>(result.incomplete), us(latency.min()), latency.mean() / 1e3,
+                      us(latency.percentile(50)), us(latency.percentile(90)), us(latency.percentile(99)),
+                      us(latency.percentile(99.9)), us(latency.max()));
+        std::string json = line;
+        bool first = true;
+        for (const auto &[status, count] : result.statusCounts)
+        {
+            std::snprintf(line, sizeof line, "%s\"%d\": %llu", first ? "" : ", ", status,
+                          static_cast<unsigned long long>(count));
+            json += line;
+            first = false;
+        }
+        json += "}}\n";
+        return json;
+    }
+
+    void report(const Options &options, const InetAddress &server, const LoadResult &result)
+    {
+        const LatencyHistogram &latency = result.latency;
+        std::fprintf(stderr, "%.1fs %s test @ %s%s\n", result.seconds,
+                     options.load.rate > 0 ? "open-loop" : "closed-loop", server.toIpPort().c_str(),
+                     options.embedded ? " (embedded)" : "");
+        std::fprintf(stderr, "  %d threads, %d connections, pipeline %d, %s", options.load.threads,
+                     options.load.connections, options.load.pipeline,
+                     options.load.keepAlive ? "keep-alive" : "connection per request");
+        if (options.load.rate > 0)
+        {
+            std::fprintf(stderr, ", target %.1f req/s", options.load.rate);
+        }
+        std::fprintf(stderr, "\n  %llu requests, %.1f req/s, %.2f MB/s\n",
+                     static_cast<unsigned long long>(result.requests), result.rps(),
+                     result.seconds > 0 ? static_cast<double>(result.bytes) / result.seconds / 1e6 : 0);
+        std::fprintf(stderr, "  latency us: min %.1f, mean %.1f, max %.1f\n", latency.min() / 1e3,
+                     latency.mean() / 1e3, latency.max() / 1e3);
+        for (double p : {50.0, 75.0, 90.0, 99.0, 99.9, 99.99})
+        {
+            std::fprintf(stderr, "  %8.2f%%  %12.1f us\n", p, latency.percentile(p) / 1e3);
+        }
+        for (const auto &[status, count] : result.statusCounts)
+        {
+            std::fprintf(stderr, "  status %d: %llu\n", status, static_cast<unsigned long long>(count));
+        }
+        std::fprintf(stderr, "  connects %llu, connect errors %llu, lost requests %llu, incomplete %llu\n",
+                     static_cast<unsigned long long>(result.connects),
+                     static_cast<unsigned long long>(result.connectErrors),
+                     static_cast<unsigned long long>(result.readErrors),
+                     static_cast<unsigned long long>(result.incomplete));
+    }
+
+    double numberField(const std::string &line, const char *key)
+    {
+        std::string pattern = std::string("\"") + key + "\": ";
+        size_t pos = line.find(pattern);
+        return pos == std::string::npos ? 0 : std::atof(line.c_str() + pos + pattern.size());
+    }
+
+    // 闭环模式比较吞吐，开环模式的吞吐由 --rate 决定，比较 p99 延迟
+    int compare(const Options &options, const LoadResult &result, const std::string &baselinePath)
+    {
+        std::ifstream in(baselinePath);
+        std::string line;
+        if (!in || !std::getline(in, line))
+        {
+            std::fprintf(stderr, "cannot read baseline %s\n", baselinePath.c_str());
+            return 2;
+        }
+        bool openLoop = options.load.rate > 0;
+        const char *field = openLoop ? "p99_us" : "rps";
+        double base = numberField(line, field);
+        double current = openLoop ? result.latency.percentile(99) / 1e3 : result.rps();
+        double delta = base > 0 ? (current - base) / base * 100 : 0;
+        bool regression = openLoop ? delta > options.threshold : -delta > options.threshold;
+        std::fprintf(stderr, "\n%s: baseline %.1f, current %.1f, %+.1f%% %s\n", field, base, current, delta,
+                     regression ? "REGRESSION" : "");
+        if (result.errors() > 0)
+        {
+            std::fprintf(stderr, "%llu error(s)\n", static_cast<unsigned long long>(result.errors()));
+        }
+        return regression || result.errors() > 0 ? 1 : 0;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    Options options;
+    if (!parseOptions(argc, argv, &options))
+    {
+        usage(argv[0]);
+        return 2;
+    }
+    if (options.load.mix.empty())
+    {
+        options.load.mix = defaultMix();
+    }
+
+    InetAddress server(options.port, options.ip);
+    options.load.host = server.toIpPort();
+
+    // 服务器的逐请求日志会成为瓶颈，内嵌模式只保留警告和错误
+    std::unique_ptr<EmbeddedServer> embedded;
+    if (options.embedded)
+    {
+        Logger::instance().setLevel(Logger::kWarn);
+        embedded = std::make_unique<EmbeddedServer>(server, options.serverThreads);
+    }
+
+    LoadGenerator generator(server, options.load);
+    LoadResult result = generator.run();
+    embedded.reset();
+
+    report(options, server, result);
+    std::string json = toJson(options, result);
+    if (options.output.empty())
+    {
+        std::fputs(json.c_str(), stdout);
+    }
+    else
+    {
+        std::ofstream out(options.output);
+        out << json;
+    }
+
+    if (!options.baseline.empty())
+    {
+        return compare(options, result, options.baseline);
+    }
+    return 0;
+}
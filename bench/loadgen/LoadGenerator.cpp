@@ -0,0 +1,764 @@
+// LoadGenerator.cpp
+#include "LoadGenerator.h"
+#include "HttpRequest.h"
+#include "cc_muduo/Channel.h"
+#include "cc_muduo/EventLoop.h"
+#include "cc_muduo/EventLoopThread.h"
+#include "cc_muduo/TimerId.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <deque>
+#include <future>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <random>
+#include <string_view>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+namespace
+{
+    int64_t nowNs()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+    constexpr size_t kIncomplete = 0;
+    constexpr size_t kMalformed = std::string_view::npos;
+    constexpr size_t kMaxHeadSize = 64 * 1024;
+
+    std::string_view trim(std::string_view value)
+    {
+        while (!value.empty() && (value.front() == ' ' || value.front() == '\t'))
+            value.remove_prefix(1);
+        while (!value.empty() && (value.back() == ' ' || value.back() == '\t'))
+            value.remove_suffix(1);
+        return value;
+    }
+
+    // 跳过 chunked 响应体，返回响应体之后的位置，不完整时返回 kIncomplete
+    size_t skipChunked(std::string_view data, size_t pos)
+    {
+        for (;;)
+        {
+            size_t lineEnd = data.find("\r\n", pos);
+            if (lineEnd == std::string_view::npos)
+            {
+                return kIncomplete;
+            }
+            size_t size = 0;
+            auto [ptr, ec] = std::from_chars(data.data() + pos, data.data() + lineEnd, size, 16);
+            if (ec != std::errc() || ptr == data.data() + pos)
+            {
+                return kMalformed;
+            }
+            pos = lineEnd + 2;
+            if (size == 0)
+            {
+                // 最后一块之后是可选的 trailer 和空行
+                if (data.size() < pos + 2)
+                {
+                    return kIncomplete;
+                }
+                if (data.compare(pos, 2, "\r\n") == 0)
+                {
+                    return pos + 2;
+                }
+                size_t end = data.find("\r\n\r\n", pos);
+                return end == std::string_view::npos ? kIncomplete : end + 4;
+            }
+            if (data.size() < pos + size + 2)
+            {
+                return kIncomplete;
+            }
+            pos += size + 2;
+        }
+    }
+
+    // 解析 data 开头的一个响应，返回它的长度；不完整时返回 kIncomplete，格式错误时返回 kMalformed。
+    // 没有长度信息的响应以连接关闭为结束，只有 eof 时才完整
+    size_t parseResponse(std::string_view data, bool eof, int *status, bool *close)
+    {
+        size_t headEnd = data.find("\r\n\r\n");
+        if (headEnd == std::string_view::npos)
+        {
+            return data.size() > kMaxHeadSize ? kMalformed : kIncomplete;
+        }
+        // 状态行："HTTP/1.1 200 OK"
+        if (headEnd < 12 || data.compare(0, 7, "HTTP/1.") != 0)
+        {
+            return kMalformed;
+        }
+        auto [ptr, ec] = std::from_chars(data.data() + 9, data.data() + 12, *status);
+        if (ec != std::errc() || ptr != data.data() + 12)
+        {
+            return kMalformed;
+        }
+
+        // HTTP/1.0 默认不保持连接
+        *close = data[7] == '0';
+        bool chunked = false;
+        bool hasLength = false;
+        size_t contentLength = 0;
+        std::string_view head = data.substr(0, headEnd);
+        size_t lineEnd = head.find("\r\n");
+        while (lineEnd != std::string_view::npos)
+        {
+            size_t lineStart = lineEnd + 2;
+            lineEnd = head.find("\r\n", lineStart);
+            std::string_view line = head.substr(lineStart, lineEnd == std::string_view::npos
+                                                               ? std::string_view::npos
+                                                               : lineEnd - lineStart);
+            size_t colon = line.find(':');
+            if (colon == std::string_view::npos)
+            {
+                continue;
+            }
+            std::string_view name = line.substr(0, colon);
+            std::string_view value = trim(line.substr(colon + 1));
+            if (HttpRequest::equalsIgnoreCase(name, "Content-Length"))
+            {
+                auto [end, err] = std::from_chars(value.data(), value.data() + value.size(), contentLength);
+                if (err != std::errc() || end != value.data() + value.size())
+                {
+                    return kMalformed;
+                }
+                hasLength = true;
+            }
+            else if (HttpRequest::equalsIgnoreCase(name, "Transfer-Encoding"))
+            {
+                chunked = HttpRequest::hasToken(value, "chunked");
+            }
+            else if (HttpRequest::equalsIgnoreCase(name, "Connection"))
+            {
+                if (HttpRequest::hasToken(value, "close"))
+                    *close = true;
+                else if (HttpRequest::hasToken(value, "keep-alive"))
+                    *close = false;
+            }
+        }
+
+        size_t bodyStart = headEnd + 4;
+        if (*status < 200 || *status == 204 || *status == 304)
+        {
+            return bodyStart;
+        }
+        if (chunked)
+        {
+            return skipChunked(data, bodyStart);
+        }
+        if (hasLength)
+        {
+            return data.size() - bodyStart >= contentLength ? bodyStart + contentLength : kIncomplete;
+        }
+        if (!eof)
+        {
+            return kIncomplete;
+        }
+        *close = true;
+        return data.size();
+    }
+
+    // 请求报文，Host 和连接方式对所有请求相同
+    std::string buildRequest(const LoadRequest &request, const LoadConfig &config)
+    {
+        std::string text;
+        text.reserve(128 + request.path.size() + request.body.size());
+        text.append(request.method).append(" ").append(request.path).append(" HTTP/1.1\r\n");
+        text.append("Host: ").append(config.host).append("\r\n");
+        if (!config.keepAlive)
+        {
+            text.append("Connection: close\r\n");
+        }
+        if (!request.body.empty())
+        {
+            text.append("Content-Type: application/json\r\n");
+            text.append("Content-Length: ").append(std::to_string(request.body.size())).append("\r\n");
+        }
+        text.append("\r\n").append(request.body);
+        return text;
+    }
+
+    class LoadConnection;
+}
+
+// 一个压测线程：在自己的 EventLoop 中驱动一组连接，统计只在本线程内更新，结束时交给 run() 合并
+class LoadWorker
+{
+public:
+    LoadWorker(EventLoop *loop, const InetAddress &server, const LoadConfig &config,
+               const std::vector<std::string> &requests, const std::vector<int> &cumulativeWeights,
+               int firstConnection, int connections, uint64_t seed);
+    ~LoadWorker();
+
+    // 以下两个函数在 loop 线程中调用
+    void start(int64_t startNs, int64_t measureStartNs, int64_t endNs);
+    LoadResult stop();
+
+    EventLoop *loop() const { return loop_; }
+    const InetAddress &server() const { return server_; }
+    const LoadConfig &config() const { return config_; }
+    bool openLoop() const { return config_.rate > 0; }
+    bool stopped() const { return stopped_; }
+    int64_t intervalNs() const { return intervalNs_; }
+
+    // 按权重随机选择下一个请求
+    const std::string &nextRequest();
+
+    void onResponse(int64_t startNs, int64_t doneNs, int status, size_t bytes);
+    void onConnected();
+    void onConnectError();
+    void onLost(size_t requests);
+
+private:
+    bool measuring() const { return nowNs() >= measureStartNs_; }
+    void onTick();
+
+    EventLoop *loop_;
+    const InetAddress &server_;
+    const LoadConfig &config_;
+    const std::vector<std::string> &requests_;
+    const std::vector<int> &cumulativeWeights_;
+    int firstConnection_;
+    int connectionCount_;
+    int64_t intervalNs_ = 0; // 开环模式下单个连接的请求间隔
+    std::mt19937_64 random_;
+
+    std::vector<std::unique_ptr<LoadConnection>> connections_;
+    TimerId tick_;
+    int64_t measureStartNs_ = 0;
+    int64_t endNs_ = 0;
+    bool stopped_ = false;
+    LoadResult result_;
+};
+
+namespace
+{
+    // 一个 keep-alive 连接。闭环模式下收到响应就补发请求，保持 pipeline 个在途；
+    // 开环模式下请求按计划时刻进入积压队列，在途数低于 pipeline 时依次发出
+    class LoadConnection
+    {
+    public:
+        LoadConnection(LoadWorker *worker, int64_t firstIntendedNs)
+            : worker_(worker), nextIntendedNs_(firstIntendedNs)
+        {
+        }
+
+        ~LoadConnection() { closeSocket(false); }
+
+        LoadConnection(const LoadConnection &) = delete;
+        LoadConnection &operator=(const LoadConnection &) = delete;
+
+        void connect();
+
+        // 开环模式：把 now 之前到期的计划时刻加入积压队列
+        void schedule(int64_t now)
+        {
+            while (nextIntendedNs_ <= now)
+            {
+                backlog_.push_back(nextIntendedNs_);
+                nextIntendedNs_ += worker_->intervalNs();
+            }
+        }
+
+        // 补充在途请求并写出
+        void fill();
+
+        // 结束压测：返回起始时刻不早于 since 却没有完成的请求数，并关闭连接
+        uint64_t shutdown(int64_t since)
+        {
+            uint64_t incomplete = 0;
+            for (int64_t start : inflight_)
+                incomplete += start >= since;
+            for (int64_t start : backlog_)
+                incomplete += start >= since;
+            inflight_.clear();
+            backlog_.clear();
+            closeSocket(false);
+            return incomplete;
+        }
+
+    private:
+        void onWritable();
+        void onReadable();
+        void flush();
+        void drainResponses(bool eof);
+        // 丢弃在途请求，重新连接
+        void fail();
+        // deferred 为 true 时处于 Channel 的回调中，Channel 推迟到下一轮再销毁
+        void closeSocket(bool deferred);
+        void reconnectLater();
+
+        LoadWorker *worker_;
+        int fd_ = -1;
+        std::unique_ptr<Channel> channel_;
+        bool connected_ = false;
+        bool reconnectPending_ = false;
+        std::string output_;
+        size_t written_ = 0;
+        std::string input_;
+        std::deque<int64_t> inflight_; // 已写出、等待响应的请求的起始时刻
+        std::deque<int64_t> backlog_;  // 开环模式下已到期、还未发出的请求的计划时刻
+        int64_t nextIntendedNs_;
+    };
+
+    void LoadConnection::connect()
+    {
+        if (worker_->stopped())
+        {
+            return;
+        }
+        fd_ = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd_ < 0)
+        {
+            worker_->onConnectError();
+            reconnectLater();
+            return;
+        }
+        int one = 1;
+        ::setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+        const sockaddr_in *addr = worker_->server().getSockAddr();
+        if (::connect(fd_, reinterpret_cast<const sockaddr *>(addr), sizeof *addr) < 0 && errno != EINPROGRESS)
+        {
+            closeSocket(false);
+            worker_->onConnectError();
+            reconnectLater();
+            return;
+        }
+
+        channel_ = std::make_unique<Channel>(worker_->loop(), fd_);
+        channel_->setWriteCallback([this]()
+                                   { onWritable(); });
+        channel_->setReadCallback([this](Timestamp)
+                                  { onReadable(); });
+        channel_->setCloseCallback([this]()
+                                   { onReadable(); });
+        channel_->setErrorCallback([this]()
+                                   { fail(); });
+        // 连接完成时套接字可写
+        channel_->enableWriting();
+    }
+
+    void LoadConnection::fill()
+    {
+        if (!connected_ || worker_->stopped())
+        {
+            return;
+        }
+        const LoadConfig &config = worker_->config();
+        size_t depth = config.keepAlive ? static_cast<size_t>(std::max(1, config.pipeline)) : 1;
+        size_t before = inflight_.size();
+        int64_t now = worker_->openLoop() ? 0 : nowNs();
+        while (inflight_.size() < depth)
+        {
+            int64_t start = now;
+            if (worker_->openLoop())
+            {
+                if (backlog_.empty())
+                {
+                    break;
+                }
+                start = backlog_.front();
+                backlog_.pop_front();
+            }
+            output_.append(worker_->nextRequest());
+            inflight_.push_back(start);
+        }
+        // 套接字写满时等可写回调写出剩余部分
+        if (inflight_.size() != before && !channel_->isWriting())
+        {
+            flush();
+        }
+    }
+
+    void LoadConnection::flush()
+    {
+        while (written_ < output_.size())
+        {
+            // 对端已关闭时不产生 SIGPIPE，错误由返回值处理
+            ssize_t n = ::send(fd_, output_.data() + written_, output_.size() - written_, MSG_NOSIGNAL);
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                if (errno == EAGAIN)
+                {
+                    if (!channel_->isWriting())
+                    {
+                        channel_->enableWriting();
+                    }
+                    return;
+                }
+                fail();
+                return;
+            }
+            written_ += static_cast<size_t>(n);
+        }
+        output_.clear();
+        written_ = 0;
+        if (channel_->isWriting())
+        {
+            channel_->disableWriting();
+        }
+    }
+
+    void LoadConnection::onWritable()
+    {
+        if (!connected_)
+        {
+            int err = 0;
+            socklen_t len = sizeof err;
+            ::getsockopt(fd_, SOL_SOCKET, SO_ERROR, &err, &len);
+            if (err != 0)
+            {
+                closeSocket(true);
+                worker_->onConnectError();
+                reconnectLater();
+                return;
+            }
+            connected_ = true;
+            worker_->onConnected();
+            channel_->enableReading();
+            channel_->disableWriting();
+            fill();
+            return;
+        }
+        flush();
+    }
+
+    void LoadConnection::onReadable()
+    {
+        if (fd_ < 0)
+        {
+            return;
+        }
+        char buf[64 * 1024];
+        bool eof = false;
+        for (;;)
+        {
+            ssize_t n = ::read(fd_, buf, sizeof buf);
+            if (n > 0)
+            {
+                input_.append(buf, static_cast<size_t>(n));
+                continue;
+            }
+            if (n == 0)
+            {
+                eof = true;
+                break;
+            }
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            if (errno == EAGAIN)
+            {
+                break;
+            }
+            fail();
+            return;
+        }
+        drainResponses(eof);
+    }
+
+    void LoadConnection::drainResponses(bool eof)
+    {
+        std::string_view data(input_);
+        size_t offset = 0;
+        bool close = false;
+        int64_t now = nowNs();
+        while (!inflight_.empty() && offset < data.size() && !close)
+        {
+            int status = 0;
+            size_t n = parseResponse(data.substr(offset), eof, &status, &close);
+            if (n == kMalformed)
+            {
+                fail();
+                return;
+            }
+            if (n == kIncomplete)
+            {
+                break;
+            }
+            worker_->onResponse(inflight_.front(), now, status, n);
+            inflight_.pop_front();
+            offset += n;
+        }
+        if (inflight_.empty() && offset < data.size() && !close)
+        {
+            // 没有请求却收到了数据
+            fail();
+            return;
+        }
+        input_.erase(0, offset);
+
+        if (close || eof || (!worker_->config().keepAlive && inflight_.empty()))
+        {
+            // 服务器关闭连接后剩下的在途请求不会再有响应
+            worker_->onLost(inflight_.size());
+            inflight_.clear();
+            closeSocket(true);
+            connect();
+            return;
+        }
+        fill();
+    }
+
+    void LoadConnection::fail()
+    {
+        worker_->onLost(inflight_.size());
+        inflight_.clear();
+        closeSocket(true);
+        connect();
+    }
+
+    void LoadConnection::closeSocket(bool deferred)
+    {
+        if (fd_ < 0)
+        {
+            return;
+        }
+        if (channel_)
+        {
+            channel_->disableAll();
+            channel_->remove();
+        }
+        Channel *channel = channel_.release();
+        int fd = fd_;
+        fd_ = -1;
+        connected_ = false;
+        output_.clear();
+        written_ = 0;
+        input_.clear();
+        // 套接字和 Channel 一起推迟关闭，回调返回之前 fd 不会被新连接复用
+        if (deferred)
+        {
+            worker_->loop()->queueInLoop([channel, fd]()
+                                         {
+                                             delete channel;
+                                             ::close(fd); });
+        }
+        else
+        {
+            delete channel;
+            ::close(fd);
+        }
+    }
+
+    void LoadConnection::reconnectLater()
+    {
+        // 服务器不可用时每 100ms 重试一次，避免空转
+        if (reconnectPending_ || worker_->stopped())
+        {
+            return;
+        }
+        reconnectPending_ = true;
+        worker_->loop()->runAfter(0.1, [this]()
+                                  {
+                                      reconnectPending_ = false;
+                                      connect(); });
+    }
+}
+
+LoadWorker::LoadWorker(EventLoop *loop, const InetAddress &server, const LoadConfig &config,
+                       const std::vector<std::string> &requests, const std::vector<int> &cumulativeWeights,
+                       int firstConnection, int connections, uint64_t seed)
+    : loop_(loop),
+      server_(server),
+      config_(config),
+      requests_(requests),
+      cumulativeWeights_(cumulativeWeights),
+      firstConnection_(firstConnection),
+      connectionCount_(connections),
+      random_(seed)
+{
+    if (config_.rate > 0)
+    {
+        intervalNs_ = std::max<int64_t>(1, static_cast<int64_t>(config_.connections * 1e9 / config_.rate));
+    }
+}
+
+LoadWorker::~LoadWorker() = default;
+
+void LoadWorker::start(int64_t startNs, int64_t measureStartNs, int64_t endNs)
+{
+    measureStartNs_ = measureStartNs;
+    endNs_ = endNs;
+    // 开环模式下第 i 个连接的计划时刻错开 i / connections 个间隔，合起来是均匀的请求流
+    for (int i = 0; i < connectionCount_; ++i)
+    {
+        int64_t phase = intervalNs_ * (firstConnection_ + i) / std::max(1, config_.connections);
+        connections_.push_back(std::make_unique<LoadConnection>(this, startNs + phase));
+    }
+    for (auto &connection : connections_)
+    {
+        connection->connect();
+    }
+    if (openLoop())
+    {
+        tick_ = loop_->runEvery(0.001, [this]()
+                                { onTick(); });
+    }
+}
+
+LoadResult LoadWorker::stop()
+{
+    stopped_ = true;
+    if (openLoop())
+    {
+        loop_->cancel(tick_);
+    }
+    for (auto &connection : connections_)
+    {
+        if (openLoop())
+        {
+            connection->schedule(endNs_);
+        }
+        result_.incomplete += connection->shutdown(measureStartNs_);
+    }
+    result_.seconds = static_cast<double>(endNs_ - measureStartNs_) / 1e9;
+    return result_;
+}
+
+void LoadWorker::onTick()
+{
+    int64_t now = nowNs();
+    for (auto &connection : connections_)
+    {
+        connection->schedule(now);
+        connection->fill();
+    }
+}
+
+const std::string &LoadWorker::nextRequest()
+{
+    if (requests_.size() == 1)
+    {
+        return requests_.front();
+    }
+    std::uniform_int_distribution<int> pick(0, cumulativeWeights_.back() - 1);
+    auto it = std::upper_bound(cumulativeWeights_.begin(), cumulativeWeights_.end(), pick(random_));
+    return requests_[static_cast<size_t>(it - cumulativeWeights_.begin())];
+}
+
+void LoadWorker::onResponse(int64_t startNs, int64_t doneNs, int status, size_t bytes)
+{
+    if (startNs < measureStartNs_)
+    {
+        return;
+    }
+    if (doneNs > endNs_)
+    {
+        ++result_.incomplete;
+        return;
+    }
+    ++result_.requests;
+    result_.bytes += bytes;
+    ++result_.statusCounts[status];
+    result_.latency.record(static_cast<uint64_t>(std::max<int64_t>(0, doneNs - startNs)));
+}
+
+void LoadWorker::onConnected()
+{
+    if (measuring())
+        ++result_.connects;
+}
+
+void LoadWorker::onConnectError()
+{
+    if (measuring())
+        ++result_.connectErrors;
+}
+
+void LoadWorker::onLost(size_t requests)
+{
+    if (measuring())
+        result_.readErrors += requests;
+}
+
+void LoadResult::merge(const LoadResult &other)
+{
+    seconds = std::max(seconds, other.seconds);
+    requests += other.requests;
+    bytes += other.bytes;
+    connects += other.connects;
+    connectErrors += other.connectErrors;
+    readErrors += other.readErrors;
+    incomplete += other.incomplete;
+    for (const auto &[status, count] : other.statusCounts)
+    {
+        statusCounts[status] += count;
+    }
+    latency.merge(other.latency);
+}
+
+LoadGenerator::LoadGenerator(const InetAddress &server, LoadConfig config)
+    : server_(server), config_(std::move(config))
+{
+    if (config_.mix.empty())
+    {
+        config_.mix.push_back(LoadRequest());
+    }
+    config_.connections = std::max(1, config_.connections);
+    config_.threads = std::max(1, std::min(config_.threads, config_.connections));
+}
+
+LoadGenerator::~LoadGenerator() = default;
+
+LoadResult LoadGenerator::run()
+{
+    std::vector<std::string> requests;
+    std::vector<int> cumulativeWeights;
+    int totalWeight = 0;
+    for (const LoadRequest &request : config_.mix)
+    {
+        requests.push_back(buildRequest(request, config_));
+        totalWeight += std::max(1, request.weight);
+        cumulativeWeights.push_back(totalWeight);
+    }
+
+    // 连接按线程平分，余数分给前面的线程
+    int firstConnection = 0;
+    for (int i = 0; i < config_.threads; ++i)
+    {
+        int connections = config_.connections / config_.threads + (i < config_.connections % config_.threads ? 1 : 0);
+        auto thread = std::make_unique<EventLoopThread>(EventLoopThread::ThreadInitCallback(),
+                                                        "loadgen-" + std::to_string(i));
+        EventLoop *loop = thread->startLoop();
+        workers_.push_back(std::make_unique<LoadWorker>(loop, server_, config_, requests, cumulativeWeights,
+                                                        firstConnection, connections, 0x9e3779b97f4a7c15ULL * (i + 1)));
+        threads_.push_back(std::move(thread));
+        firstConnection += connections;
+    }
+
+    int64_t startNs = nowNs();
+    int64_t measureStartNs = startNs + static_cast<int64_t>(config_.warmup * 1e9);
+    int64_t endNs = measureStartNs + static_cast<int64_t>(config_.duration * 1e9);
+    for (auto &worker : workers_)
+    {
+        LoadWorker *w = worker.get();
+        w->loop()->runInLoop([w, startNs, measureStartNs, endNs]()
+                             { w->start(startNs, measureStartNs, endNs); });
+    }
+
+    std::this_thread::sleep_until(std::chrono::steady_clock::time_point(std::chrono::nanoseconds(endNs)));
+
+    LoadResult total;
+    for (auto &worker : workers_)
+    {
+        LoadWorker *w = worker.get();
+        std::promise<LoadResult> stopped;
+        w->loop()->runInLoop([w, &stopped]()
+                             { stopped.set_value(w->stop()); });
+        total.merge(stopped.get_future().get());
+    }
+    return total;
+}
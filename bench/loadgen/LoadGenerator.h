@@ -0,0 +1,77 @@
+// LoadGenerator.h
+#pragma once
+
+#include "LatencyHistogram.h"
+#include "cc_muduo/InetAddress.h"
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+class EventLoopThread;
+class LoadWorker;
+
+// 请求组合中的一种请求，按 weight 占全部权重的比例发送
+struct LoadRequest
+{
+    int weight = 1;
+    std::string method = "GET";
+    std::string path = "/";
+    std::string body; // 非空时带 Content-Type: application/json 发送
+};
+
+struct LoadConfig
+{
+    int connections = 64;
+    int threads = 2;
+    int pipeline = 1;      // 每个连接最多同时在途的请求数
+    bool keepAlive = true; // 为 false 时每个请求带 Connection: close，响应后重新连接
+    double rate = 0;       // 全部连接合计的每秒请求数，0 为闭环模式
+    double duration = 10;  // 测量窗口的秒数
+    double warmup = 2;     // 开始测量之前的预热秒数，期间的请求不计入结果
+    std::string host = "localhost";
+    std::vector<LoadRequest> mix;
+};
+
+// 测量窗口内的统计。开环模式下延迟从请求按计划应当发出的时刻算起，
+// 服务器停顿期间积压的请求也计入停顿的时间，避免协调遗漏（coordinated omission）
+struct LoadResult
+{
+    double seconds = 0;
+    uint64_t requests = 0; // 完成的响应数
+    uint64_t bytes = 0;    // 读到的响应字节数
+    uint64_t connects = 0;
+    uint64_t connectErrors = 0;
+    uint64_t readErrors = 0; // 连接异常断开或响应格式错误时丢失的请求数
+    uint64_t incomplete = 0; // 测量结束时仍未完成的请求，包括开环模式下积压未发的
+    std::map<int, uint64_t> statusCounts;
+    LatencyHistogram latency; // 纳秒
+
+    double rps() const { return seconds > 0 ? static_cast<double>(requests) / seconds : 0; }
+    uint64_t errors() const { return connectErrors + readErrors; }
+    void merge(const LoadResult &other);
+};
+
+// 回环压测客户端：config.threads 个 EventLoopThread 平分全部连接，
+// 每个连接是一个非阻塞套接字和 Channel，请求按 pipeline 深度批量写出
+class LoadGenerator
+{
+public:
+    LoadGenerator(const InetAddress &server, LoadConfig config);
+    ~LoadGenerator();
+
+    LoadGenerator(const LoadGenerator &) = delete;
+    LoadGenerator &operator=(const LoadGenerator &) = delete;
+
+    // 阻塞运行 warmup + duration 秒，返回测量窗口内的统计
+    LoadResult run();
+
+private:
+    InetAddress server_;
+    LoadConfig config_;
+    // 先销毁线程（退出事件循环），再销毁其中使用的 worker
+    std::vector<std::unique_ptr<LoadWorker>> workers_;
+    std::vector<std::unique_ptr<EventLoopThread>> threads_;
+};